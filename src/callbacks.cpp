@@ -24,22 +24,36 @@
 
 #include "callbacks.h"
 
+static thread_local String s_threadMessagePrefix;
+
+void setThreadMessagePrefix(const String &prefix)
+{
+	s_threadMessagePrefix = prefix;
+}
+
+String takeThreadMessagePrefix()
+{
+	String prefix;
+	prefix.swap(s_threadMessagePrefix);
+	return prefix;
+}
+
 void(*info)(const String &level, const String &file, const String &msg)
 	= [](const String &level, const String &file, const String &msg) -> void
 	{
-		printf("[%s] %s: %s\n", level.c_str(), file.c_str(), msg.c_str());
+		printf("%s[%s] %s: %s\n", takeThreadMessagePrefix().c_str(), level.c_str(), file.c_str(), msg.c_str());
 	};
 
 void(*error)(const String &level, const String &file, const String &msg)
 	= [](const String &level, const String &file, const String &msg) -> void
 	{
-		printf("<error> [%s] %s: %s\n", level.c_str(), file.c_str(), msg.c_str());
+		printf("%s<error> [%s] %s: %s\n", takeThreadMessagePrefix().c_str(), level.c_str(), file.c_str(), msg.c_str());
 	};
 
 void(*warning)(const String &level, const String &file, const String &msg)
 	= [](const String &level, const String &file, const String &msg) -> void
 	{
-		printf("<warning> [%s] %s: %s\n", level.c_str(), file.c_str(), msg.c_str());
+		printf("%s<warning> [%s] %s: %s\n", takeThreadMessagePrefix().c_str(), level.c_str(), file.c_str(), msg.c_str());
 	};
 
 /* eof */
@@ -26,6 +26,14 @@ extern void(*info)(const String &level, const String &file, const String &msg);
 extern void(*error)(const String &level, const String &file, const String &msg);
 extern void(*warning)(const String &level, const String &file, const String &msg);
 
+/**
+ * @brief Sets text printed in front of the next message reported by the calling thread
+ *
+ * Used to keep progress information in the same line as the message when several threads report at once.
+ */
+void setThreadMessagePrefix(const String &prefix);
+String takeThreadMessagePrefix();
+
 template < typename ...Args >
 void info_f(const String &level, const String &file, const String &format, Args ...args)
 {
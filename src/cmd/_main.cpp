@@ -22,6 +22,7 @@
 
 #include <prerequisites.h>
 
+#include <config.h>
 #include <resource_lib.h>
 #include <model/model.h>
 #include <model/animation.h>
@@ -32,10 +33,14 @@
 #include <fs/file.h>
 #include <fs/sysfilesystem.h>
 #include <fs/uberfilesystem.h>
+#include <fs/write_behind.h>
+#include <fs/prefetcher.h>
 #include <structs/pmg_0x15.h>
 #include <structs/pma_0x05.h>
+#include <utils/thread_pool.h>
 
 #include <chrono>
+#include <cinttypes>
 
 void print_help()
 {
@@ -84,12 +89,51 @@ void print_help()
 		   "  --calc-cityhash64-file <file_path>\n"
 		   "              mode: calculate and print to stdout cityhash64 of given file (file_path is absolute path)\n"
 		   "\n"
+		   "  --benchmark-lookups <dir_path>\n"
+		   "              mode: measures lookups per second of every file in given directory (dir_path is relative to base)\n"
+		   "\n"
+		   "  --benchmark-models <dir_path>\n"
+		   "              mode: measures loading of every model in given directory and its subdirectories, median of 5 rounds; with file cache only decoding is measured (dir_path is relative to base)\n"
+		   "\n"
 		   "  --output-material-format147\n"
 		   "              switch: output materials in 1.47 mid-format\n"
 		   "\n"
 		   "  --output-dds-dxt10\n"
 		   "              switch: output DDS files in DXT10 format\n"
 		   "\n"
+		   "  --mmap-archives\n"
+		   "              switch: map archives (scs, zip) into memory instead of reading them with regular file I/O\n"
+		   "\n"
+		   "  -j, --jobs <count>\n"
+		   "              number of worker threads used when converting entire base (0 = number of CPU cores, default: 1)\n"
+		   "\n"
+		   "  --file-cache <size_mb>\n"
+		   "              memory budget of cache of decompressed archive entries opened repeatedly (0 = disabled, default: 256)\n"
+		   "\n"
+		   "  --inflate-checkpoints <size_kb>\n"
+		   "              distance between checkpoints allowing to seek in compressed archive entries (0 = disabled, default: 0)\n"
+		   "\n"
+		   "  --gdeflate-workers <count>\n"
+		   "              number of threads decompressing single GDeflate archive entry (0 = number of CPU cores, default: 0)\n"
+		   "\n"
+		   "  --mount-index-cache <dir_path>\n"
+		   "              directory where parsed tables of mounted archives are kept, so unchanged archives mount faster next time (default: disabled)\n"
+		   "\n"
+		   "  --preload-directories\n"
+		   "              switch: decode all directory listings of hashfs v2 archives when mounting them, so listing directories needs no further reads\n"
+		   "\n"
+		   "  --directory-walkers <count>\n"
+		   "              number of threads listing subdirectories of base directories on disk (0 = number of CPU cores, default: 1)\n"
+		   "\n"
+		   "  --write-behind <size_mb>\n"
+		   "              memory budget of output files waiting to be written to disk by separate thread, write errors are reported once conversion ends (0 = disabled, default: 0)\n"
+		   "\n"
+		   "  --prefetch <size_mb>\n"
+		   "              memory budget of files of upcoming models read ahead when converting entire base, kept in file cache until converted (0 = disabled, default: 32)\n"
+		   "\n"
+		   "  --resource-cache <size_mb>\n"
+		   "              memory budget of loaded texture objects and materials, unused ones are dropped, tobjs are never exported twice (0 = unlimited, default: 64)\n"
+		   "\n"
 		   " Usage:\n"
 		   "\n"
 		   "  converter_pix -b C:\\ets2_base -m /vehicle/truck/man_tgx/interior/anim s_wheel\n"
@@ -143,6 +187,8 @@ void print_help()
 bool convertSingleModel(String filepath, String exportpath, Array<String> optionalArgs);
 bool convertWholeBase(FileSystem *fs, String exportpath);
 bool printMatchingAnimations( String modelFilePath );
+bool benchmarkLookups( const String &directory );
+bool benchmarkModels( const String &directory );
 
 int main(int argc, char *argv[])
 {
@@ -168,6 +214,14 @@ int main(int argc, char *argv[])
 	String path;
 	bool listdir_r = false;
 	bool showElapsedTime = false;
+	String jobs;
+	String gdeflateWorkers;
+	String inflateCheckpoints;
+	String fileCache;
+	String directoryWalkers;
+	String writeBehind;
+	String prefetch;
+	String resourceLibrary;
 
 	enum {
 		WHOLE_BASE,
@@ -181,6 +235,8 @@ int main(int argc, char *argv[])
 		CALC_CITYHASH64,
 		CALC_CITYHASH64_FILE,
 		FIND_MODEL_ANIMATIONS,
+		BENCHMARK_LOOKUPS,
+		BENCHMARK_MODELS,
 	} mode = WHOLE_BASE;
 
 	String *parameter = nullptr;
@@ -265,6 +321,16 @@ int main(int argc, char *argv[])
 			mode = CALC_CITYHASH64_FILE;
 			parameter = &path;
 		}
+		else if( arg == "--benchmark-lookups" )
+		{
+			mode = BENCHMARK_LOOKUPS;
+			parameter = &path;
+		}
+		else if( arg == "--benchmark-models" )
+		{
+			mode = BENCHMARK_MODELS;
+			parameter = &path;
+		}
 		else if( arg == "-matFormat147" || arg == "--output-material-format147" )
 		{
 			Material::s_outputMatFormat147Enabled = true;
@@ -277,20 +343,114 @@ int main(int argc, char *argv[])
 		{
 			showElapsedTime = true;
 		}
+		else if( arg == "--mmap-archives" )
+		{
+			Config::s_mmapArchives = true;
+		}
+		else if( arg == "-j" || arg == "--jobs" )
+		{
+			parameter = &jobs;
+		}
+		else if( arg == "--file-cache" )
+		{
+			parameter = &fileCache;
+		}
+		else if( arg == "--inflate-checkpoints" )
+		{
+			parameter = &inflateCheckpoints;
+		}
+		else if( arg == "--gdeflate-workers" )
+		{
+			parameter = &gdeflateWorkers;
+		}
+		else if( arg == "--mount-index-cache" )
+		{
+			parameter = &Config::s_mountIndexDirectory;
+		}
+		else if( arg == "--preload-directories" )
+		{
+			Config::s_preloadDirectories = true;
+		}
+		else if( arg == "--directory-walkers" )
+		{
+			parameter = &directoryWalkers;
+		}
+		else if( arg == "--write-behind" )
+		{
+			parameter = &writeBehind;
+		}
+		else if( arg == "--prefetch" )
+		{
+			parameter = &prefetch;
+		}
+		else if( arg == "--resource-cache" )
+		{
+			parameter = &resourceLibrary;
+		}
 		else
 		{
 			optionalArgs.push_back( arg );
 		}
 	}
 
+	if( !jobs.empty() )
+	{
+		const int jobsCount = atoi( jobs.c_str() );
+		Config::s_jobs = jobsCount > 0 ? static_cast<u32>( jobsCount ) : ThreadPool::hardwareConcurrency();
+	}
+
+	if( !directoryWalkers.empty() )
+	{
+		const int walkersCount = atoi( directoryWalkers.c_str() );
+		Config::s_directoryWalkers = walkersCount > 0 ? static_cast<u32>( walkersCount ) : ThreadPool::hardwareConcurrency();
+	}
+
+	if( !writeBehind.empty() )
+	{
+		const int writeBehindMb = atoi( writeBehind.c_str() );
+		Config::s_writeBehindSize = writeBehindMb > 0 ? static_cast<uint64_t>( writeBehindMb ) * 1024 * 1024 : 0;
+	}
+
+	if( !prefetch.empty() )
+	{
+		const int prefetchMb = atoi( prefetch.c_str() );
+		Config::s_prefetchSize = prefetchMb > 0 ? static_cast<uint64_t>( prefetchMb ) * 1024 * 1024 : 0;
+	}
+
+	if( !resourceLibrary.empty() )
+	{
+		const int resourceLibraryMb = atoi( resourceLibrary.c_str() );
+		Config::s_resourceLibrarySize = resourceLibraryMb > 0 ? static_cast<uint64_t>( resourceLibraryMb ) * 1024 * 1024 : 0;
+	}
+
+	if( !fileCache.empty() )
+	{
+		const int fileCacheMb = atoi( fileCache.c_str() );
+		Config::s_fileCacheSize = fileCacheMb > 0 ? static_cast<uint64_t>( fileCacheMb ) * 1024 * 1024 : 0;
+	}
+
+	if( !inflateCheckpoints.empty() )
+	{
+		const int checkpointsKb = atoi( inflateCheckpoints.c_str() );
+		Config::s_inflateCheckpointInterval = checkpointsKb > 0 ? static_cast<uint64_t>( checkpointsKb ) * 1024 : 0;
+	}
+
+	if( !gdeflateWorkers.empty() )
+	{
+		const int workersCount = atoi( gdeflateWorkers.c_str() );
+		Config::s_gdeflateWorkers = workersCount > 0 ? static_cast<u32>( workersCount ) : 0;
+	}
+
 	Map<String, FileSystem *> mountedBases;
 
 	int ufsPriority = 1;
 
-	for( const String &base : basepath )
+	const Array<FileSystem *> mounted = ufsMountAll( basepath, true, ufsPriority );
+	for( size_t i = 0; i < basepath.size(); ++i )
 	{
-		mountedBases[ base ] = ufsMount( base, true, ufsPriority++ );
+		mountedBases[ basepath[ i ] ] = mounted[ i ];
 	}
+	ufsPriority += static_cast<int>( basepath.size() );
 
 	long long startTime =
 		std::chrono::duration_cast<std::chrono::microseconds>
@@ -411,18 +571,17 @@ int main(int argc, char *argv[])
 				exportpath = basepath[0] + "_exp";
 			}
 			SysFileSystem outputFileSystem( exportpath );
-			auto files = getUFS()->readDir(path, true, true);
-			if (!files)
-			{
-				error("system", "", "readDir returned null!");
-				return 1;
-			}
-			for (const auto &f : *files)
+			const bool read = getUFS()->visitDir(path, true, true, [&](const FileSystem::Entry &f)
 			{
 				if( !f.IsDirectory() )
 				{
 					extractFile( *getUFS(), f.GetPath(), outputFileSystem );
 				}
+			});
+			if (!read)
+			{
+				error("system", "", "visitDir failed!");
+				return 1;
 			}
 		} break;
 		case LIST_DIR:
@@ -433,15 +592,14 @@ int main(int argc, char *argv[])
 				return 1;
 			}
 
-			auto files = getUFS()->readDir(path, true, listdir_r);
-			if (!files)
-			{
-				error("system", "", "readDir returned null!");
-				return 1;
-			}
-			for (const auto &f : *files)
+			const bool read = getUFS()->visitDir(path, true, listdir_r, [](const FileSystem::Entry &f)
 			{
 				printf("[%s]%s %s\n", f.IsDirectory() ? "D" : "F", f.IsEncrypted() ? " (encrypted)" : "", f.GetPath().c_str());
+			});
+			if (!read)
+			{
+				error("system", "", "visitDir failed!");
+				return 1;
 			}
 
 			printf("-- done --\n");
@@ -475,6 +633,29 @@ int main(int argc, char *argv[])
 		{
 			exitCode = printMatchingAnimations( path ) ? 0 : 1;
 		} break;
+		case BENCHMARK_LOOKUPS:
+		{
+			if( basepath.empty() )
+			{
+				error( "system", "", "Not specified base path!" );
+				return 1;
+			}
+			exitCode = benchmarkLookups( path ) ? 0 : 1;
+		} break;
+		case BENCHMARK_MODELS:
+		{
+			if( basepath.empty() )
+			{
+				error( "system", "", "Not specified base path!" );
+				return 1;
+			}
+			exitCode = benchmarkModels( path ) ? 0 : 1;
+		} break;
+	}
+
+	if( Config::s_writeBehindSize > 0 && !getWriteBehindQueue()->drain() )
+	{
+		exitCode = 1;
 	}
 
 	long long endTime =
@@ -484,6 +665,9 @@ int main(int argc, char *argv[])
 	if( showElapsedTime )
 	{
 		printf( "Elapsed time: %lluus | %llums | %f s\n", endTime - startTime, ( endTime - startTime ) / 1000, static_cast<float>( endTime - startTime ) / 1000.f / 1000.f );
+
+		const FileCache::Statistics cacheStatistics = getUFS()->cacheStatistics();
+		printf( "File cache: %" PRIu64 " hits | %" PRIu64 " misses | %" PRIu64 " entries | %.1f MB\n", cacheStatistics.m_hits, cacheStatistics.m_misses, cacheStatistics.m_entries, cacheStatistics.m_bytes / 1024.f / 1024.f );
 	}
 
 	return exitCode;
@@ -503,28 +687,14 @@ bool convertSingleModel(String filepath, String exportpath, Array<String> option
 	{
 		if (optionalArgs[i] == "*")
 		{
-			auto files = getUFS()->readDir(model->fileDirectory(), true, false);
-
-			// remove files with no .pma extension
-			files->erase(
-				std::remove_if(files->begin(), files->end(),
-					[](const FileSystem::Entry &s) {
-						return s.IsDirectory() || s.GetPath().substr(s.GetPath().rfind('.')) != ".pma";
-					}
-				), files->end()
-			);
-
-			// remove extensions
-			std::for_each(files->begin(), files->end(),
-				[&](FileSystem::Entry &s) {
-					s.SetPath(s.GetPath().substr(0, s.GetPath().rfind('.')));
-				}
-			);
-
-			for (const auto &f : (*files))
+			// append every .pma next to the model, without extension
+			getUFS()->visitDir(model->fileDirectory(), true, false, [&](const FileSystem::Entry &f)
 			{
-				optionalArgs.push_back(f.GetPath());
-			}
+				if (!f.IsDirectory() && extractExtension(f.GetPath()) == ".pma")
+				{
+					optionalArgs.push_back(removeExtension(f.GetPath()));
+				}
+			});
 			continue;
 		}
 		backslashesToSlashes(optionalArgs[i]);
@@ -543,64 +713,170 @@ bool convertSingleModel(String filepath, String exportpath, Array<String> option
 
 bool convertWholeBase( FileSystem *fs, String exportpath )
 {
-	auto files = fs->readDir("/", true, true);
-	if (!files)
+	struct Job
 	{
-		printf("No files to convert!\n");
-		return false;
-	}
+		String m_filename;
+		bool m_isModel;
+		u64 m_offset; // of the primary file within the archive
+	};
 
-	int size = 0;
-	for (const auto &f : *files)
+	// only files to be converted are kept, not the whole listing of the base
+	Array<Job> jobs;
+	const bool read = fs->visitDir("/", true, true, [&](const FileSystem::Entry &f)
 	{
 		if (f.IsDirectory())
-			continue;
+			return;
 
 		const Optional<StringView> extension = extractExtension(f.GetPath());
-		if (extension.has_value() && (extension.value() == ".pmg" || extension.value() == ".tobj"))
-		{
-			++size;
-		}
+		if (extension != ".pmg" && extension != ".tobj")
+			return;
+
+		jobs.push_back({ f.GetPath(), extension == ".pmg", fs->archiveOffset(f.GetPath()) });
+	});
+	if (!read)
+	{
+		printf("No files to convert!\n");
+		return false;
 	}
 
-	int i = 0;
-	for (const auto &f : *files)
+	// archive is then read mostly front to back instead of jumping across it in listing order,
+	// files on disk have no offset and keep their listing order
+	std::stable_sort(jobs.begin(), jobs.end(), [](const Job &a, const Job &b)
 	{
-		if (f.IsDirectory())
-			continue;
+		return a.m_offset < b.m_offset;
+	});
+	const int size = static_cast<int>(jobs.size());
 
-		const String filename = f.GetPath();
-		const Optional<StringView> extension = extractExtension(f.GetPath());
-		if (extension == ".pmg")
+	// number of already reported files, used only to print progress
+	std::atomic<int> i = 0;
+	auto progress = [&]() -> String
+	{
+		const int current = i++;
+		return fmt::sprintf("[%u/%u = %u%%]: ", current, size, (unsigned)(100.f * current / size));
+	};
+
+	auto convertFile = [&](const String &filename, bool isModel)
+	{
+		if (isModel)
 		{
 			const String modelPath = filename.substr(0, filename.length() - 4);
 			Model model;
 			if (!model.load(modelPath))
 			{
+				++i;
 				printf("Failed to load: %s\n", modelPath.c_str());
 			}
 			else
 			{
-				printf("[%u/%u = %u%%]: ", i, size, (unsigned)(100.f * i / size));
+				setThreadMessagePrefix(progress());
 				model.saveToMidFormat(exportpath, false);
+				setThreadMessagePrefix("");
 			}
-			++i;
 		}
-		else if (extension == ".tobj")
+		else
 		{
-			printf("[%u/%u = %u%%]: ", i, size, (unsigned)(100.f * i / size));
-			printf("%s: tobj: ", filename.substr(directory(filename).length() + 1).c_str());
+			// shared with materials of converted models, so the tobj is exported only once
+			const ResourceLibrary::Entry tobj = ResourceLibrary::Get()->obtain(filename);
+			const bool converted = tobj && tobj->saveToMidFormats(exportpath);
+			printf("%s%s: tobj: %s\n", progress().c_str(), filename.substr(directory(filename).length() + 1).c_str(), converted ? "ok" : "failed");
+		}
+	};
 
-			TextureObject tobj;
-			if (tobj.load(filename))
+	// files of the next few models are read and decompressed by the prefetcher while the current ones are converted
+	UniquePtr<Prefetcher> prefetcher;
+	if (Config::s_prefetchSize > 0 && Config::s_fileCacheSize > 0)
+	{
+		prefetcher = std::make_unique<Prefetcher>(getUFS());
+	}
+	const size_t lookahead = prefetcher ? 8 + 2 * static_cast<size_t>(Config::s_jobs) : 0;
+
+	UniquePtr<ThreadPool> pool;
+	if (Config::s_jobs > 1)
+	{
+		pool = std::make_unique<ThreadPool>(Config::s_jobs);
+	}
+
+	struct Pending
+	{
+		String m_filename;
+		bool m_isModel;
+		Prefetcher::Ticket m_ticket;
+	};
+	List<Pending> window;
+
+	// jobs handed to the pool are limited to its threads, so files are requested at most lookahead jobs ahead of conversion
+	std::mutex dispatchMutex;
+	std::condition_variable jobFinished;
+	u32 running = 0;
+
+	auto dispatch = [&](Pending pending)
+	{
+		auto convert = [&convertFile, &prefetcher, pending]
+		{
+			convertFile(pending.m_filename, pending.m_isModel);
+			if (prefetcher)
 			{
-				tobj.saveToMidFormats(exportpath);
-				printf("ok\n");
+				prefetcher->release(pending.m_ticket);
+			}
+		};
+		if (pool)
+		{
+			{
+				std::unique_lock<std::mutex> lock(dispatchMutex);
+				jobFinished.wait(lock, [&] { return running < Config::s_jobs; });
+				++running;
 			}
-			++i;
+			pool->submit([&, convert]
+			{
+				convert();
+				std::lock_guard<std::mutex> lock(dispatchMutex);
+				--running;
+				jobFinished.notify_one();
+			});
+		}
+		else
+		{
+			convert();
+		}
+	};
+
+	const u64 bytesReadBefore = FileSystem::archiveBytesRead();
+	const auto startTime = std::chrono::steady_clock::now();
+
+	for (Job &job : jobs)
+	{
+		Pending pending{ std::move(job.m_filename), job.m_isModel, 0 };
+		if (prefetcher)
+		{
+			const String base = pending.m_filename.substr(0, pending.m_filename.length() - (job.m_isModel ? 4 : 5));
+			pending.m_ticket = job.m_isModel
+				? prefetcher->request({ base + ".pmd", base + ".pmg", base + ".ppd", base + ".pmc" })
+				: prefetcher->request({ pending.m_filename, base + ".dds" }); // tobj usually references texture of the same name
+		}
+
+		window.push_back(std::move(pending));
+		if (window.size() > lookahead)
+		{
+			dispatch(std::move(window.front()));
+			window.pop_front();
 		}
 	}
+	Array<Job>().swap(jobs);
+
+	for (Pending &pending : window)
+	{
+		dispatch(std::move(pending));
+	}
+
+	if (pool)
+	{
+		pool->wait();
+	}
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	const double megabytesRead = (FileSystem::archiveBytesRead() - bytesReadBefore) / 1024.0 / 1024.0;
 	printf("\nBase converted: %s\n", exportpath.c_str());
+	printf("Read %.1f MB from archives in %.2f s (%.1f MB/s)\n", megabytesRead, seconds, seconds > 0 ? megabytesRead / seconds : 0.0);
 	return true;
 }
 
@@ -640,18 +916,11 @@ bool printMatchingAnimations( String modelFilePath )
 		return false;
 	}
 
-	const auto entries = getUFS()->readDir( "/", true, true );
-	if( entries == nullptr )
-	{
-		printf( "Unable to list root directory recursively!\n" );
-		return false;
-	}
-
-	for( const FileSystem::Entry &entry : *entries )
+	const bool read = getUFS()->visitDir( "/", true, true, [ & ]( const FileSystem::Entry &entry )
 	{
 		if( entry.IsDirectory() )
 		{
-			continue;
+			return;
 		}
 
 		const String &filePath = entry.GetPath();
@@ -662,24 +931,140 @@ bool printMatchingAnimations( String modelFilePath )
 			const UniquePtr<File> animationFile = getUFS()->open( filePath, FileSystem::read | FileSystem::binary );
 			if( animationFile == nullptr )
 			{
-				continue;
+				return;
 			}
 			prism::pma_0x05::pma_header_t header;
 			if( !animationFile->blockRead( &header, 0, sizeof( header ) ) )
 			{
-				continue;
+				return;
 			}
 			if( header.m_version != header.SUPPORTED_VERSION )
 			{
-				continue;
+				return;
 			}
 			if( header.m_skeleton_hash == skeletonHash )
 			{
 				printf( "%s\n", filePath.c_str() );
 			}
 		}
+	} );
+	if( !read )
+	{
+		printf( "Unable to list root directory recursively!\n" );
+		return false;
+	}
+
+	return true;
+}
+
+bool benchmarkLookups( const String &directory )
+{
+	Array<String> existing;
+	Array<String> missing;
+	const bool read = getUFS()->visitDir( directory, true, true, [ & ]( const FileSystem::Entry &entry )
+	{
+		if( !entry.IsDirectory() )
+		{
+			existing.push_back( entry.GetPath() );
+			missing.push_back( entry.GetPath() + "~" );
+		}
+	} );
+	if( !read )
+	{
+		error( "system", directory, "visitDir failed!" );
+		return false;
+	}
+	if( existing.empty() )
+	{
+		printf( "No files to look up in \'%s\'!\n", directory.c_str() );
+		return false;
 	}
 
+	auto measure = [&]( const char *name, const Array<String> &paths, bool expected )
+	{
+		const u32 rounds = static_cast<u32>( std::max<size_t>( 1, 2000000 / paths.size() ) );
+		u64 found = 0;
+		const auto begin = std::chrono::steady_clock::now();
+		for( u32 round = 0; round < rounds; ++round )
+		{
+			for( const String &path : paths )
+			{
+				found += getUFS()->exists( path ) ? 1 : 0;
+			}
+		}
+		const double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - begin ).count();
+		const u64 lookups = u64( rounds ) * paths.size();
+		printf( "%s: %" PRIu64 " lookups in %.3f s = %.0f lookups/s%s\n", name, lookups, seconds, lookups / seconds, found == ( expected ? lookups : 0 ) ? "" : " (unexpected results!)" );
+	};
+
+	printf( "Benchmarking lookups of %" PRIu64 " files\n", static_cast<u64>( existing.size() ) );
+	measure( "existing", existing, true );
+	measure( "missing", missing, false );
+	return true;
+}
+
+bool benchmarkModels( const String &directory )
+{
+	Array<String> models;
+	const bool read = getUFS()->visitDir( directory, true, true, [ & ]( const FileSystem::Entry &entry )
+	{
+		if( !entry.IsDirectory() && extractExtension( entry.GetPath() ) == ".pmg" )
+		{
+			models.push_back( removeExtension( entry.GetPath() ) );
+		}
+	} );
+	if( !read )
+	{
+		error( "system", directory, "visitDir failed!" );
+		return false;
+	}
+	if( models.empty() )
+	{
+		printf( "No models to load in \'%s\'!\n", directory.c_str() );
+		return false;
+	}
+
+	// the first round warms up the caches and is not measured, the median of remaining ones is reported;
+	// files fitting the file cache are then served decompressed from it, so only decoding of them is measured
+	const u32 rounds = 5;
+	Array<double> times;
+	u64 vertices = 0;
+	FileCache::Statistics cacheBefore;
+	for( u32 round = 0; round <= rounds; ++round )
+	{
+		if( round == 1 )
+		{
+			cacheBefore = getUFS()->cacheStatistics();
+		}
+		vertices = 0;
+		const auto begin = std::chrono::steady_clock::now();
+		for( const String &path : models )
+		{
+			Model model;
+			if( !model.load( path ) )
+			{
+				return false;
+			}
+			vertices += model.vertexCount();
+		}
+		const double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - begin ).count();
+		if( round > 0 )
+		{
+			times.push_back( seconds );
+		}
+	}
+	std::nth_element( times.begin(), times.begin() + times.size() / 2, times.end() );
+	const double median = times[ times.size() / 2 ];
+
+	printf( "Loaded %" PRIu64 " models with %" PRIu64 " vertices in %.3f s (median of %u rounds) = %.0f vertices/s\n",
+			static_cast<u64>( models.size() ), vertices, median, rounds, vertices / median );
+	const FileCache::Statistics cacheAfter = getUFS()->cacheStatistics();
+	const u64 hits = cacheAfter.m_hits - cacheBefore.m_hits;
+	const u64 opens = hits + cacheAfter.m_misses - cacheBefore.m_misses;
+	if( hits > 0 )
+	{
+		printf( "File cache served %" PRIu64 " of %" PRIu64 " opened files, only decoding of those was measured (--file-cache 0 measures reading and decompression too)\n", hits, opens );
+	}
 	return true;
 }
 
@@ -25,5 +25,16 @@
 #include "config.h"
 
 bool Config::s_verbose = false;
+u32 Config::s_jobs = 1;
+bool Config::s_mmapArchives = false;
+uint64_t Config::s_fileCacheSize = 256 * 1024 * 1024;
+uint64_t Config::s_inflateCheckpointInterval = 0;
+u32 Config::s_gdeflateWorkers = 0;
+String Config::s_mountIndexDirectory;
+uint64_t Config::s_writeBehindSize = 0;
+uint64_t Config::s_prefetchSize = 32 * 1024 * 1024;
+uint64_t Config::s_resourceLibrarySize = 64 * 1024 * 1024;
+u32 Config::s_directoryWalkers = 1;
+bool Config::s_preloadDirectories = false;
 
 /* eof */
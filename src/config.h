@@ -26,6 +26,17 @@ class Config
 {
 public:
 	static bool s_verbose; /* TODO: To implement */
+	static u32 s_jobs; /* number of worker threads used when converting whole base */
+	static bool s_mmapArchives; /* map archives (scs, zip) into memory instead of reading them with stdio */
+	static uint64_t s_fileCacheSize; /* byte budget of cache of decompressed archive entries, 0 = disabled */
+	static uint64_t s_inflateCheckpointInterval; /* distance in bytes between saved inflate states of compressed archive entries, 0 = disabled */
+	static u32 s_gdeflateWorkers; /* number of threads decompressing tiles of single GDeflate entry, 0 = number of CPU cores */
+	static String s_mountIndexDirectory; /* directory of persistent cache of parsed archive tables, empty = disabled */
+	static uint64_t s_writeBehindSize; /* byte budget of output files waiting to be written by the writer thread, 0 = written directly */
+	static uint64_t s_prefetchSize; /* byte budget of files read ahead of conversion of entire base, 0 = disabled */
+	static uint64_t s_resourceLibrarySize; /* byte budget of tobjs and materials kept by ResourceLibrary, 0 = unlimited */
+	static u32 s_directoryWalkers; /* number of threads walking subdirectories of directories on disk in parallel, 1 = sequential */
+	static bool s_preloadDirectories; /* decode all directory listings of hashfs v2 archives when mounting and keep them in memory */
 };
 
 /* eof */
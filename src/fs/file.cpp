@@ -257,6 +257,16 @@ File &operator>>(File &fp, unsigned char *s)
 	return fp;
 }
 
+const void *File::map( uint64_t offset, uint64_t size ) const
+{
+	return nullptr;
+}
+
+bool File::copyRangeTo( File *output, uint64_t offset, uint64_t size )
+{
+	return false;
+}
+
 bool File::blockRead(void *buffer, uint64_t offset, uint64_t size)
 {
 	if (tell() != offset)
@@ -269,6 +279,11 @@ bool File::blockRead(void *buffer, uint64_t offset, uint64_t size)
 	return read(buffer, 1, size) == size;
 }
 
+bool File::readAt(void *buffer, uint64_t offset, uint64_t size)
+{
+	return blockRead(buffer, offset, size);
+}
+
 bool File::blockWrite( const void *buffer, uint64_t size )
 {
 	return write( buffer, 1, size ) == size;
@@ -284,6 +299,14 @@ bool copyFile(File *const input, File *const output)
 {
 	input->rewind();
 	uint64_t toCopy = input->size();
+	if (input->copyRangeTo(output, 0, toCopy))
+	{
+		return true;
+	}
+	if (const void *const mapped = input->map(0, toCopy))
+	{
+		return output->write(mapped, 1, toCopy) == toCopy;
+	}
 	const uint64_t bufferSize = 10 * 1024 * 1024;
 	uint8_t *buffer = new uint8_t[bufferSize];
 	for (uint64_t readed = 0; toCopy > 0 && (readed = input->read((char *)buffer, 1, std::min(bufferSize, toCopy))) != 0; toCopy -= readed)
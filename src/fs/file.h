@@ -51,8 +51,26 @@ public:
 	virtual void flush() = 0;
     virtual void mstat( MetaStat *result ) = 0;
 
+	/**
+	 * Returns pointer to given range of file contents when the file resides in memory, nullptr otherwise.
+	 */
+	virtual const void *map( uint64_t offset, uint64_t size ) const;
+
+	/**
+	 * Appends given range of file contents to output file inside the OS (copy_file_range, sendfile), without reading it into memory.
+	 * Returns false without writing anything when it is not possible, caller has to copy the contents itself then.
+	 */
+	virtual bool copyRangeTo( File *output, uint64_t offset, uint64_t size );
+
 	bool blockRead(void *buffer, uint64_t offset, uint64_t size);
 
+	/**
+	 * Positional read: reads exactly size bytes at given offset without using the file position.
+	 * Implementations backed by the OS (pread) or memory are safe to call from multiple threads at once,
+	 * the default one falls back to blockRead and is not.
+	 */
+	virtual bool readAt(void *buffer, uint64_t offset, uint64_t size);
+
 	bool blockWrite( const void *buffer, uint64_t size );
 
 	bool getContents( Array<u8> &buffer );
@@ -0,0 +1,267 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/file_cache.cpp
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+#include <prerequisites.h>
+
+#include "file_cache.h"
+
+#include "filesystem.h"
+
+#include <config.h>
+
+/**
+ * @brief Serves cached entry from memory
+ */
+class CachedFile : public File
+{
+public:
+	CachedFile(std::shared_ptr<const Array<u8>> blob, FileSystem *filesystem, const String &path)
+		: m_blob(std::move(blob))
+		, m_filesystem(filesystem)
+		, m_path(path)
+	{
+	}
+
+	virtual uint64_t write(const void *buffer, uint64_t elementSize, uint64_t elementCount) override
+	{
+		return 0;
+	}
+
+	virtual uint64_t read(void *buffer, uint64_t elementSize, uint64_t elementCount) override
+	{
+		if (m_position >= m_blob->size())
+		{
+			return 0;
+		}
+		const uint64_t bytes = std::min<uint64_t>(elementSize * elementCount, m_blob->size() - m_position);
+		memcpy(buffer, m_blob->data() + m_position, static_cast<size_t>(bytes));
+		m_position += bytes;
+		return bytes;
+	}
+
+	virtual uint64_t size() override
+	{
+		return m_blob->size();
+	}
+
+	virtual bool seek(uint64_t offset, Attrib attr) override
+	{
+		if (attr == SeekSet)
+		{
+			m_position = offset;
+		}
+		else if (attr == SeekCur)
+		{
+			m_position += offset;
+		}
+		else if (attr == SeekEnd)
+		{
+			m_position = size() - offset;
+		}
+		return true;
+	}
+
+	virtual void rewind() override
+	{
+		m_position = 0;
+	}
+
+	virtual uint64_t tell() const override
+	{
+		return m_position;
+	}
+
+	virtual void flush() override
+	{
+	}
+
+	virtual void mstat(MetaStat *result) override
+	{
+		m_filesystem->mstat(result, m_path);
+	}
+
+	virtual const void *map(uint64_t offset, uint64_t size) const override
+	{
+		if (offset > m_blob->size() || size > m_blob->size() - offset)
+		{
+			return nullptr;
+		}
+		return m_blob->data() + offset;
+	}
+
+private:
+	std::shared_ptr<const Array<u8>> m_blob;
+	FileSystem *m_filesystem;
+	String m_path;
+	uint64_t m_position = 0;
+};
+
+/**
+ * @brief Forwards to file opened from filesystem, stores its contents in the cache once read whole
+ */
+class CachingFile : public File
+{
+public:
+	CachingFile(FileCache *cache, const Pair<const FileSystem *, u64> &key, UniquePtr<File> file)
+		: m_cache(cache)
+		, m_key(key)
+		, m_file(std::move(file))
+	{
+	}
+
+	virtual uint64_t write(const void *buffer, uint64_t elementSize, uint64_t elementCount) override
+	{
+		return m_file->write(buffer, elementSize, elementCount);
+	}
+
+	virtual uint64_t read(void *buffer, uint64_t elementSize, uint64_t elementCount) override
+	{
+		const bool whole = m_file->tell() == 0 && elementSize * elementCount >= m_file->size();
+		const uint64_t result = m_file->read(buffer, elementSize, elementCount);
+		if (whole && result > 0 && result == m_file->size() && result <= Config::s_fileCacheSize)
+		{
+			const u8 *const data = static_cast<const u8 *>(buffer);
+			m_cache->insert(m_key, std::make_shared<const Array<u8>>(data, data + result));
+		}
+		return result;
+	}
+
+	virtual uint64_t size() override { return m_file->size(); }
+	virtual bool seek(uint64_t offset, Attrib attr) override { return m_file->seek(offset, attr); }
+	virtual void rewind() override { m_file->rewind(); }
+	virtual uint64_t tell() const override { return m_file->tell(); }
+	virtual void flush() override { m_file->flush(); }
+	virtual void mstat(MetaStat *result) override { m_file->mstat(result); }
+	virtual const void *map(uint64_t offset, uint64_t size) const override { return m_file->map(offset, size); }
+	virtual bool copyRangeTo(File *output, uint64_t offset, uint64_t size) override { return m_file->copyRangeTo(output, offset, size); }
+
+private:
+	FileCache *m_cache;
+	Pair<const FileSystem *, u64> m_key;
+	UniquePtr<File> m_file;
+};
+
+FileCache::FileCache()
+{
+}
+
+UniquePtr<File> FileCache::open(FileSystem *filesystem, u64 hash, const String &path)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_entries.find(Key(filesystem, hash));
+	if (it == m_entries.end())
+	{
+		return UniquePtr<File>();
+	}
+	m_lru.splice(m_lru.begin(), m_lru, it->second);
+	++m_hits;
+	return std::make_unique<CachedFile>(it->second->second, filesystem, path);
+}
+
+UniquePtr<File> FileCache::wrap(FileSystem *filesystem, u64 hash, UniquePtr<File> file)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		++m_misses;
+	}
+	return std::make_unique<CachingFile>(this, Key(filesystem, hash), std::move(file));
+}
+
+void FileCache::insert(const Key &key, Blob blob)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_entries.find(key);
+	if (it != m_entries.end())
+	{
+		m_bytes -= it->second->second->size();
+		m_lru.erase(it->second);
+		m_entries.erase(it);
+	}
+
+	m_bytes += blob->size();
+	m_lru.emplace_front(key, std::move(blob));
+	m_entries[key] = m_lru.begin();
+	evict();
+}
+
+void FileCache::evict()
+{
+	// least recently used unpinned entries go first
+	for (auto victim = m_lru.end(); m_bytes > Config::s_fileCacheSize && victim != m_lru.begin();)
+	{
+		--victim;
+		if (m_pins.find(victim->first) != m_pins.end())
+		{
+			continue;
+		}
+		m_bytes -= victim->second->size();
+		m_entries.erase(victim->first);
+		victim = m_lru.erase(victim);
+	}
+}
+
+void FileCache::pin(const FileSystem *filesystem, u64 hash)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	++m_pins[Key(filesystem, hash)];
+}
+
+void FileCache::unpin(const FileSystem *filesystem, u64 hash)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_pins.find(Key(filesystem, hash));
+	if (it != m_pins.end() && --it->second == 0)
+	{
+		m_pins.erase(it);
+		evict();
+	}
+}
+
+void FileCache::erase(const FileSystem *filesystem)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (auto it = m_lru.begin(); it != m_lru.end();)
+	{
+		if (it->first.first == filesystem)
+		{
+			m_bytes -= it->second->size();
+			m_entries.erase(it->first);
+			it = m_lru.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+FileCache::Statistics FileCache::statistics() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Statistics result;
+	result.m_hits = m_hits;
+	result.m_misses = m_misses;
+	result.m_bytes = m_bytes;
+	result.m_entries = m_entries.size();
+	return result;
+}
+
+/* eof */
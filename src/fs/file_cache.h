@@ -0,0 +1,96 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/file_cache.h
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+#pragma once
+
+#include "file.h"
+
+/**
+ * @brief Byte-budgeted LRU cache of decompressed entries of read-only filesystems
+ *
+ * Sits in front of UberFileSystem::open. Entry is stored when a file opened through the cache
+ * is read whole from the beginning, following opens of the same entry are served from memory.
+ * Budget is given by Config::s_fileCacheSize. Pinned entries are not evicted, they may keep the cache
+ * above its budget until they are unpinned.
+ */
+class FileCache
+{
+public:
+	struct Statistics
+	{
+		u64 m_hits = 0;
+		u64 m_misses = 0;
+		u64 m_bytes = 0;
+		u64 m_entries = 0;
+	};
+
+public:
+	FileCache();
+	FileCache(const FileCache &) = delete;
+	FileCache &operator=(const FileCache &) = delete;
+
+	/**
+	 * @brief Returns file reading cached entry, nullptr when entry is not cached
+	 * @param[in] filesystem Filesystem which the entry belongs to
+	 * @param[in] hash Hash of the entry path
+	 * @param[in] path Path of the entry, used by mstat
+	 */
+	UniquePtr<File> open(FileSystem *filesystem, u64 hash, const String &path);
+
+	/**
+	 * @brief Wraps file freshly opened from filesystem, so its contents are stored once read whole
+	 */
+	UniquePtr<File> wrap(FileSystem *filesystem, u64 hash, UniquePtr<File> file);
+
+	/**
+	 * @brief Keeps entry from being evicted until it is unpinned, entry does not have to be cached yet; pins nest
+	 */
+	void pin(const FileSystem *filesystem, u64 hash);
+	void unpin(const FileSystem *filesystem, u64 hash);
+
+	/**
+	 * @brief Drops every entry of given filesystem, has to be called before it is unmounted
+	 */
+	void erase(const FileSystem *filesystem);
+
+	Statistics statistics() const;
+
+private:
+	using Key = Pair<const FileSystem *, u64>;
+	using Blob = std::shared_ptr<const Array<u8>>;
+	using LruList = List<Pair<Key, Blob>>;
+
+	void insert(const Key &key, Blob blob);
+	void evict(); // called under m_mutex
+
+private:
+	mutable std::mutex m_mutex;
+	LruList m_lru; // most recently used first
+	Map<Key, LruList::iterator> m_entries;
+	Map<Key, u32> m_pins; // pin count of entries
+	u64 m_bytes = 0;
+	u64 m_hits = 0;
+	u64 m_misses = 0;
+
+	friend class CachingFile;
+};
+
+/* eof */
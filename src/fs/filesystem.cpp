@@ -31,6 +31,11 @@
 #include "zipfilesystem.h"
 
 #include "file.h"
+#include "mapped_file.h"
+
+#include <config.h>
+
+#include <utils/thread_pool.h>
 
 FileSystem::FileSystem()
 {
@@ -40,11 +45,36 @@ FileSystem::~FileSystem()
 {
 }
 
+auto FileSystem::readDir( const String &path, bool absolutePaths, bool recursive ) -> UniquePtr<List<Entry>>
+{
+	auto result = std::make_unique<List<Entry>>();
+	const bool read = visitDir( path, absolutePaths, recursive, [ & ]( const Entry &entry )
+	{
+		result->push_back( entry );
+	} );
+	return read ? std::move( result ) : nullptr;
+}
+
 UniquePtr<File> FileSystem::openForReadingWithPlainMeta( const String &filename, const prism::fs_meta_plain_t &plainMetaValues, bool *outFileExists )
 {
 	return nullptr;
 }
 
+namespace
+{
+	std::atomic<u64> s_archiveBytesRead = 0;
+}
+
+u64 FileSystem::archiveBytesRead()
+{
+	return s_archiveBytesRead.load( std::memory_order_relaxed );
+}
+
+void FileSystem::countArchiveRead( u64 bytes )
+{
+	s_archiveBytesRead.fetch_add( bytes, std::memory_order_relaxed );
+}
+
 SysFileSystem *getSFS()
 {
 	static SysFileSystem fs("");
@@ -57,13 +87,26 @@ UberFileSystem *getUFS()
 	return &fs;
 }
 
-FileSystem *ufsMount(const String &root, scs_bool readOnly, int priority)
+UniquePtr<File> openArchiveRoot(const String &root)
+{
+	if (Config::s_mmapArchives)
+	{
+		auto mapped = std::make_unique<MappedFile>();
+		if (mapped->open(root))
+		{
+			return mapped;
+		}
+		warning("system", root, "Unable to map archive into memory, falling back to regular reads!");
+	}
+	return getSFS()->open(root, FileSystem::read | FileSystem::binary);
+}
+
+UniquePtr<FileSystem> ufsOpen(const String &root)
 {
 	if (getSFS()->dirExists(root))
 	{
 		String rootdirectory = makeSlashAtEnd(root);
-		auto fs = std::make_unique<SysFileSystem>(rootdirectory.substr(0, rootdirectory.length() - 1));
-		return getUFS()->mount(std::move(fs), priority);
+		return std::make_unique<SysFileSystem>(rootdirectory.substr(0, rootdirectory.length() - 1));
 	}
 	else if(getSFS()->exists(root))
 	{
@@ -73,24 +116,60 @@ FileSystem *ufsMount(const String &root, scs_bool readOnly, int priority)
 		rootfile.reset();
 		if (sig[0] == 'P' && sig[1] == 'K') // zip
 		{
-			auto fs = std::make_unique<ZipFileSystem>(root);
-			return getUFS()->mount(std::move(fs), priority);
+			return std::make_unique<ZipFileSystem>(root);
 		}
 		else if (sig[0] == 'S' && sig[1] == 'C' && sig[2] == 'S' && sig[3] == '#' && sig[4] == 1 ) // scs# version 1
 		{
-			auto fs = std::make_unique<HashFileSystem>(root);
-			return getUFS()->mount(std::move(fs), priority);
+			return std::make_unique<HashFileSystem>(root);
 		}
 		else if (sig[0] == 'S' && sig[1] == 'C' && sig[2] == 'S' && sig[3] == '#' && sig[4] == 2 ) // scs# version 2
 		{
-			auto fs = std::make_unique<HashFsV2>(root);
-			return getUFS()->mount(std::move(fs), priority);
+			return std::make_unique<HashFsV2>(root);
 		}
 	}
 	warning("system", root, "Unknown filesystem type!");
 	return nullptr;
 }
 
+FileSystem *ufsMount(const String &root, scs_bool readOnly, int priority)
+{
+	UniquePtr<FileSystem> fs = ufsOpen(root);
+	if (!fs)
+	{
+		return nullptr;
+	}
+	return getUFS()->mount(std::move(fs), priority);
+}
+
+Array<FileSystem *> ufsMountAll(const Array<String> &roots, scs_bool readOnly, int firstPriority)
+{
+	// archives are parsed in parallel (mostly waiting for I/O), then mounted in the given order
+	Array<UniquePtr<FileSystem>> opened(roots.size());
+	if (roots.size() > 1)
+	{
+		const u32 threads = std::min<u32>(static_cast<u32>(roots.size()), std::max<u32>(8, ThreadPool::hardwareConcurrency()));
+		ThreadPool pool(threads - 1);
+		pool.parallelFor(static_cast<u32>(roots.size()), [&](u32 index)
+		{
+			opened[index] = ufsOpen(roots[index]);
+		});
+	}
+	else if (roots.size() == 1)
+	{
+		opened[0] = ufsOpen(roots[0]);
+	}
+
+	Array<FileSystem *> mounted(roots.size(), nullptr);
+	for (size_t i = 0; i < roots.size(); ++i)
+	{
+		if (opened[i])
+		{
+			mounted[i] = getUFS()->mount(std::move(opened[i]), firstPriority + static_cast<int>(i));
+		}
+	}
+	return mounted;
+}
+
 void ufsUnmount(FileSystem *fs)
 {
 	getUFS()->unmount(fs);
@@ -41,6 +41,7 @@ public:
 	static constexpr FsOpenMode append =	( FsOpenMode )( 1 << 2 );
 	static constexpr FsOpenMode update =	( FsOpenMode )( 1 << 3 );
 	static constexpr FsOpenMode binary =	( FsOpenMode )( 1 << 4 );
+	static constexpr FsOpenMode direct =	( FsOpenMode )( 1 << 5 ); // written before close returns, never by write-behind
 
 public:
 	FileSystem();
@@ -71,12 +72,51 @@ public:
 	virtual bool exists( const String &filename ) = 0;
 	virtual bool dirExists( const String &dirpath ) = 0;
 	
-	virtual UniquePtr<List<Entry>> readDir( const String &path, bool absolutePaths, bool recursive ) = 0;
+	using DirVisitor = std::function<void( const Entry &entry )>;
+
+	/**
+	 * Calls visitor for every entry of directory as soon as it is read, without building list of them.
+	 * Returns false when directory cannot be read.
+	 */
+	virtual bool visitDir( const String &path, bool absolutePaths, bool recursive, const DirVisitor &visitor ) = 0;
+
+	/**
+	 * Collects entries given by visitDir into list, nullptr when directory cannot be read.
+	 */
+	UniquePtr<List<Entry>> readDir( const String &path, bool absolutePaths, bool recursive );
 	
 	virtual bool mstat( MetaStat *result, const String &path ) = 0;
 
 	virtual UniquePtr<File> openForReadingWithPlainMeta( const String &filename, const prism::fs_meta_plain_t &plainMetaValues, bool *outFileExists = nullptr );
 
+	/**
+	 * Contents of read-only filesystem do not change while it is mounted (archives), so they can be cached.
+	 */
+	virtual bool isReadOnly() const { return false; }
+
+	/**
+	 * Calls visitor with CityHash64 of path (without leading slash) of every entry, files and directories alike.
+	 * Returns false when entries cannot be enumerated that way (salted archives, writable filesystems),
+	 * UberFileSystem then asks such filesystem directly on every lookup.
+	 */
+	virtual bool visitEntryHashes( const std::function<void( u64 hash )> &/*visitor*/ ) const { return false; }
+
+	/**
+	 * Returns position of data of the file within archive, so that files can be read in the order they are stored.
+	 * Returns UINT64_MAX when position is not known (directories, files on disk).
+	 */
+	virtual u64 archiveOffset( const String &/*path*/ ) { return UINT64_MAX; }
+
+	/**
+	 * Returns number of bytes read (or mapped) from archive files by all filesystems, used to report read throughput.
+	 */
+	static u64 archiveBytesRead();
+
+protected:
+	static void countArchiveRead( u64 bytes );
+
+public:
+
 	inline String root( const String &path )
 	{
 		const String rootPath = root();
@@ -92,7 +132,7 @@ public:
 	}
 
 	Entry(String path, bool directory, bool encrypted, FileSystem *filesystem)
-		: m_path(path)
+		: m_path(std::move(path))
 		, m_directory(directory)
 		, m_encrypted(encrypted)
 		, m_filesystem(filesystem)
@@ -173,7 +213,23 @@ constexpr FileSystem::FsOpenMode operator|(const FileSystem::FsOpenMode t, const
 SysFileSystem *getSFS();
 UberFileSystem *getUFS();
 
+/**
+ * Opens root file of archive filesystem, memory mapped when enabled by Config::s_mmapArchives.
+ */
+UniquePtr<File> openArchiveRoot(const String &root);
+
+/**
+ * Creates filesystem of given root (directory or archive) without mounting it, nullptr when type is unknown.
+ */
+UniquePtr<FileSystem> ufsOpen(const String &root);
+
 FileSystem *ufsMount(const String &root, scs_bool readOnly, int priority);
+
+/**
+ * Mounts roots with increasing priority starting at firstPriority, archives are parsed in parallel.
+ * Returns mounted filesystems in order of roots, nullptr for those which failed.
+ */
+Array<FileSystem *> ufsMountAll(const Array<String> &roots, scs_bool readOnly, int firstPriority);
 void ufsUnmount(FileSystem *fs);
 
 /* eof */
@@ -0,0 +1,182 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/hash_index.cpp
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+#include <prerequisites.h>
+
+#include "hash_index.h"
+
+SaltedPathHasher::SaltedPathHasher(u16 salt)
+{
+	if (salt != 0)
+	{
+		m_prefixLength = static_cast<u32>(snprintf(m_prefix, sizeof(m_prefix), "%u", salt));
+	}
+}
+
+u64 SaltedPathHasher::operator()(const String &path) const
+{
+	const char *const name = path.empty() ? path.c_str() : path.c_str() + 1; // skip leading slash
+	const size_t nameLength = path.empty() ? 0 : path.length() - 1;
+	if (m_prefixLength == 0)
+	{
+		return prism::city_hash_64(name, nameLength);
+	}
+
+	char buffer[512];
+	if (m_prefixLength + nameLength <= sizeof(buffer))
+	{
+		memcpy(buffer, m_prefix, m_prefixLength);
+		memcpy(buffer + m_prefixLength, name, nameLength);
+		return prism::city_hash_64(buffer, m_prefixLength + nameLength);
+	}
+
+	const String saltedName = String(m_prefix, m_prefixLength) + name;
+	return prism::city_hash_64(saltedName.c_str(), saltedName.length());
+}
+
+void HashIndex::build(u32 count, const std::function<u64(u32 index)> &hashAt)
+{
+	size_t capacity = 16;
+	while (capacity < size_t(count) * 2)
+	{
+		capacity *= 2;
+	}
+
+	m_slots.assign(capacity, Slot());
+	m_mask = capacity - 1;
+	m_size = 0;
+
+	for (u32 index = 0; index < count; ++index)
+	{
+		const u64 hash = hashAt(index);
+		for (size_t i = static_cast<size_t>(hash) & m_mask;; i = (i + 1) & m_mask)
+		{
+			Slot &slot = m_slots[i];
+			if (slot.m_index == NOT_FOUND)
+			{
+				slot.m_hash = hash;
+				slot.m_index = index;
+				++m_size;
+				break;
+			}
+			if (slot.m_hash == hash)
+			{
+				break;
+			}
+		}
+	}
+}
+
+void HashIndex::insert(u64 hash, u32 index)
+{
+	if ((m_size + 1) * 2 > m_slots.size())
+	{
+		rehash(std::max<size_t>(16, m_slots.size() * 2));
+	}
+
+	for (size_t i = static_cast<size_t>(hash) & m_mask;; i = (i + 1) & m_mask)
+	{
+		Slot &slot = m_slots[i];
+		if (slot.m_index == NOT_FOUND)
+		{
+			slot.m_hash = hash;
+			slot.m_index = index;
+			++m_size;
+			return;
+		}
+		if (slot.m_hash == hash)
+		{
+			slot.m_index = index;
+			return;
+		}
+	}
+}
+
+void HashIndex::erase(u64 hash)
+{
+	if (m_slots.empty())
+	{
+		return;
+	}
+
+	size_t hole = static_cast<size_t>(hash) & m_mask;
+	for (;; hole = (hole + 1) & m_mask)
+	{
+		if (m_slots[hole].m_index == NOT_FOUND)
+		{
+			return;
+		}
+		if (m_slots[hole].m_hash == hash)
+		{
+			break;
+		}
+	}
+
+	// shift following slots of the probe sequence back, so lookups never stop at the hole too early
+	for (size_t i = (hole + 1) & m_mask; m_slots[i].m_index != NOT_FOUND; i = (i + 1) & m_mask)
+	{
+		const size_t home = static_cast<size_t>(m_slots[i].m_hash) & m_mask;
+		if (((i - home) & m_mask) >= ((i - hole) & m_mask))
+		{
+			m_slots[hole] = m_slots[i];
+			hole = i;
+		}
+	}
+	m_slots[hole] = Slot();
+	--m_size;
+}
+
+void HashIndex::reserve(size_t count)
+{
+	size_t capacity = std::max<size_t>(16, m_slots.size());
+	while (capacity < count * 2)
+	{
+		capacity *= 2;
+	}
+	if (capacity != m_slots.size())
+	{
+		rehash(capacity);
+	}
+}
+
+void HashIndex::rehash(size_t capacity)
+{
+	Array<Slot> slots(capacity);
+	std::swap(m_slots, slots);
+	m_mask = capacity - 1;
+	for (const Slot &slot : slots)
+	{
+		if (slot.m_index == NOT_FOUND)
+		{
+			continue;
+		}
+		for (size_t i = static_cast<size_t>(slot.m_hash) & m_mask;; i = (i + 1) & m_mask)
+		{
+			if (m_slots[i].m_index == NOT_FOUND)
+			{
+				m_slots[i] = slot;
+				break;
+			}
+		}
+	}
+}
+
+/* eof */
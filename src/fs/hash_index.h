@@ -0,0 +1,105 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/hash_index.h
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+#pragma once
+
+/**
+ * @brief Hashes archive paths the way hashfs does: CityHash64 of decimal salt followed by the path without leading slash
+ *
+ * Salt prefix is formatted once, hashing itself does not allocate unless the path is unusually long.
+ */
+class SaltedPathHasher
+{
+public:
+	explicit SaltedPathHasher(u16 salt = 0);
+
+	u64 operator()(const String &path) const;
+
+private:
+	char m_prefix[8];
+	u32 m_prefixLength = 0;
+};
+
+/**
+ * @brief Flat open-addressing table mapping entry hashes to their index in the entry table
+ *
+ * Hashes are CityHash64 values, so their low bits are used directly as the slot index.
+ * Table is kept at most half full, lookup is usually a single cache line.
+ * Besides building at once the table may be updated in place, which is used by the merged mount index.
+ */
+class HashIndex
+{
+public:
+	static constexpr u32 NOT_FOUND = UINT32_MAX;
+
+public:
+	/**
+	 * @brief Builds the table, hashAt( i ) returns hash of i-th entry. The first of duplicated hashes wins.
+	 */
+	void build(u32 count, const std::function<u64(u32 index)> &hashAt);
+
+	/**
+	 * @brief Maps the hash to the index, replacing the previous one. The table grows when needed.
+	 */
+	void insert(u64 hash, u32 index);
+
+	/**
+	 * @brief Removes the hash from the table, does nothing when it is not there.
+	 */
+	void erase(u64 hash);
+
+	/**
+	 * @brief Makes room for given number of hashes, so inserting them does not grow the table
+	 */
+	void reserve(size_t count);
+
+	u32 find(u64 hash) const
+	{
+		if (m_slots.empty())
+		{
+			return NOT_FOUND;
+		}
+		for (size_t i = static_cast<size_t>(hash) & m_mask;; i = (i + 1) & m_mask)
+		{
+			const Slot &slot = m_slots[i];
+			if (slot.m_index == NOT_FOUND || slot.m_hash == hash)
+			{
+				return slot.m_index;
+			}
+		}
+	}
+
+private:
+	struct Slot
+	{
+		u64 m_hash = 0;
+		u32 m_index = NOT_FOUND;
+	};
+
+	void rehash(size_t capacity);
+
+private:
+	Array<Slot> m_slots;
+	size_t m_mask = 0;
+	size_t m_size = 0;
+};
+
+/* eof */
@@ -35,7 +35,7 @@ static constexpr uint32_t HASHFS_MAX_ENTRIES = 250000;
 HashFileSystem::HashFileSystem(const String &root)
 {
 	m_rootFilename = root;
-	m_root = getSFS()->open(root, FileSystem::read | FileSystem::binary);
+	m_root = openArchiveRoot(root);
 	if (!m_root)
 	{
 		error("hashfs", root, "Unable to open root file");
@@ -138,14 +138,14 @@ bool HashFileSystem::dirExists(const String &dirpath)
 	return true;
 }
 
-auto HashFileSystem::readDir(const String &path, bool absolutePaths, bool recursive) -> UniquePtr<List<Entry>>
+bool HashFileSystem::visitDir(const String &path, bool absolutePaths, bool recursive, const DirVisitor &visitor)
 {
 	using namespace prism;
 
 	if (path.empty())
 	{
-		error("hashfs", m_rootFilename, "readDir: Path is empty!");
-		return UniquePtr<List<Entry>>();
+		error("hashfs", m_rootFilename, "visitDir: Path is empty!");
+		return false;
 	}
 
 	String dirpath = path.size() != 1 ? removeSlashAtEnd(path) : path;
@@ -154,13 +154,13 @@ auto HashFileSystem::readDir(const String &path, bool absolutePaths, bool recurs
 	if (!entry)
 	{
 		error_f("hashfs", m_rootFilename, "Failed to open dirlist entry (%s)", path);
-		return UniquePtr<List<Entry>>();
+		return false;
 	}
 
 	if (!(entry->m_flags & HASHFS_DIR))
 	{
 		error_f("hashfs", m_rootFilename, "Entry is not directory");
-		return UniquePtr<List<Entry>>();
+		return false;
 	}
 
 	HashFsFile directoryFile(path, this, entry);
@@ -171,56 +171,38 @@ auto HashFileSystem::readDir(const String &path, bool absolutePaths, bool recurs
 	buffer[size] = '\0';
 	String data = buffer.get();
 
-	auto result = std::make_unique<List<Entry>>();
+	const String prefix = removeSlashAtEnd(dirpath) + "/";
 
 	StringTokenizer tokenizer(data, "\n");
 	for (String line; tokenizer.getNext(&line);)
 	{
-		if (line[0] == '*') // directory
-		{
-			String directorypath;
-			if (absolutePaths)
-			{
-				directorypath = removeSlashAtEnd(dirpath) + "/" + String(line.c_str() + 1);
-			}
-			else
-			{
-				directorypath = String(line.c_str() + 1);
-			}
-			result->push_back(Entry(directorypath, true, false, this));
+		const bool isDirectory = line[0] == '*';
+		const StringView name = StringView(line).substr(isDirectory ? 1 : 0);
 
-			if (recursive)
-			{
-				auto subdir = readDir(directorypath, absolutePaths, recursive);
-				if (subdir)
-				{
-					result->insert(result->end(), subdir->begin(), subdir->end());
-				}
-			}
-		}
-		else // file
-		{
-			String filepath;
-			if (absolutePaths)
-			{
-				filepath = removeSlashAtEnd(dirpath) + "/" + line.c_str();
-			}
-			else
-			{
-				filepath = line;
-			}
+		String absolutePath;
+		absolutePath.reserve(prefix.length() + name.length());
+		absolutePath.append(prefix).append(name);
 
-			bool encrypted = false;
-			prism::hashfs_entry_t *const entry = findEntry(removeSlashAtEnd(dirpath) + "/" + line.c_str());
+		bool encrypted = false;
+		if (!isDirectory)
+		{
+			prism::hashfs_entry_t *const entry = findEntry(absolutePath);
 			if (entry)
 			{
 				encrypted = !!(entry->m_flags & HASHFS_ENCRYPTED);
 			}
-			result->push_back(Entry(filepath, false, encrypted, this));
+		}
+
+		const Entry visited(absolutePaths ? std::move(absolutePath) : String(name), isDirectory, encrypted, this);
+		visitor(visited);
+
+		if (isDirectory && recursive)
+		{
+			visitDir(absolutePaths ? visited.GetPath() : prefix + visited.GetPath(), absolutePaths, recursive, visitor);
 		}
 	}
 
-	return result;
+	return true;
 }
 
 bool HashFileSystem::mstat( MetaStat *result, const String &path )
@@ -234,16 +216,56 @@ bool HashFileSystem::mstat( MetaStat *result, const String &path )
 	else return false;
 }
 
+bool HashFileSystem::visitEntryHashes(const std::function<void(u64 hash)> &visitor) const
+{
+	if (m_header.m_salt != 0)
+	{
+		return false;
+	}
+	for (const prism::hashfs_entry_t &entry : m_entries)
+	{
+		visitor(entry.m_hash);
+	}
+	return true;
+}
+
+u64 HashFileSystem::archiveOffset(const String &path)
+{
+	prism::hashfs_entry_t *const entry = findEntry(path);
+	return entry ? entry->m_offset : UINT64_MAX;
+}
+
 bool HashFileSystem::ioRead(void *const buffer, uint64_t bytes, uint64_t offset)
 {
-	return m_root->blockRead(buffer, offset, bytes);
+	countArchiveRead(bytes);
+	return m_root->readAt(buffer, offset, bytes);
+}
+
+const void *HashFileSystem::ioMap(uint64_t bytes, uint64_t offset) const
+{
+	const void *const mapped = m_root->map(offset, bytes);
+	if (mapped)
+	{
+		countArchiveRead(bytes);
+	}
+	return mapped;
+}
+
+bool HashFileSystem::ioCopy(File *output, uint64_t bytes, uint64_t offset)
+{
+	if (!m_root->copyRangeTo(output, offset, bytes))
+	{
+		return false;
+	}
+	countArchiveRead(bytes);
+	return true;
 }
 
 bool HashFileSystem::readHashFS()
 {
 	using namespace prism;
 
-	if (!m_root->blockRead(&m_header, 0, sizeof(hashfs_header_t)))
+	if (!m_root->readAt(&m_header, 0, sizeof(hashfs_header_t)))
 	{
 		error("hashfs", m_rootFilename, "Failed to read header!");
 		return false;
@@ -268,56 +290,22 @@ bool HashFileSystem::readHashFS()
 	}
 
 	m_entries.resize(m_header.m_entries_count);
-	if (!m_root->blockRead(m_entries.data(), m_header.m_start_offset, m_header.m_entries_count * sizeof(hashfs_entry_t)))
+	if (!m_root->readAt(m_entries.data(), m_header.m_start_offset, m_header.m_entries_count * sizeof(hashfs_entry_t)))
 	{
 		error("hasfs", m_rootFilename, "Failed to read entries!");
 		return false;
 	}
 
+	m_entryIndex.build(static_cast<u32>(m_entries.size()), [this](u32 index) { return m_entries[index].m_hash; });
+	m_pathHasher = SaltedPathHasher(m_header.m_salt);
+
 	return true;
 }
 
 prism::hashfs_entry_t *HashFileSystem::findEntry(const String &path)
 {
-	using namespace prism;
-
-	if (m_entries.empty())
-	{
-		return nullptr;
-	}
-
-	String pathToFind;
-	if (m_header.m_salt != 0)
-	{
-		pathToFind = fmt::sprintf("%u%s", m_header.m_salt, (path.c_str() + 1));
-	}
-	else
-	{
-		pathToFind = path.c_str() + 1;
-	}
-
-	const u64 hash = city_hash_64(pathToFind.c_str(), pathToFind.length());
-
-	for (s64 index, l = 0, r = m_entries.size() - 1; l <= r;) // binary search
-	{
-		index = l + (r - l) / 2;
-
-		if (m_entries[static_cast<size_t>(index)].m_hash == hash)
-		{
-			return &m_entries[static_cast<size_t>(index)];
-		}
-
-		if (m_entries[static_cast<size_t>(index)].m_hash < hash)
-		{
-			l = index + 1;
-		}
-		else
-		{
-			r = index - 1;
-		}
-	}
-
-	return nullptr;
+	const u32 index = m_entryIndex.find(m_pathHasher(path));
+	return index != HashIndex::NOT_FOUND ? &m_entries[index] : nullptr;
 }
 
 /* eof */
@@ -23,6 +23,8 @@
 #pragma once
 
 #include "filesystem.h"
+#include "inflate_index.h"
+#include "hash_index.h"
 
 #include <structs/hashfs.h>
 
@@ -45,17 +47,26 @@ public:
 	virtual bool rmdir(const String &directory) override;
 	virtual bool exists(const String &filename) override;
 	virtual bool dirExists(const String &dirpath) override;
-	virtual UniquePtr<List<Entry>> readDir(const String &path, bool absolutePaths, bool recursive) override;
+	virtual bool visitDir(const String &path, bool absolutePaths, bool recursive, const DirVisitor &visitor) override;
 	virtual bool mstat( MetaStat *result, const String &path ) override;
+	virtual bool isReadOnly() const override { return true; }
+	virtual bool visitEntryHashes(const std::function<void(u64 hash)> &visitor) const override;
+	virtual u64 archiveOffset(const String &path) override;
 
-	bool ioRead(void *const buffer, uint64_t bytes, uint64_t offset);
+	bool ioRead(void *const buffer, uint64_t bytes, uint64_t offset); // safe to call from multiple threads
+	const void *ioMap(uint64_t bytes, uint64_t offset) const; // nullptr when root is not memory mapped
+	bool ioCopy(File *output, uint64_t bytes, uint64_t offset); // appends range of root to output inside the OS, false when not possible
+	InflateIndex *inflateIndex(uint64_t offset, uint64_t size) { return m_inflateIndices.get(offset, size); } // checkpoints of compressed stream at given offset
 
 private:
 	String m_rootFilename;
 	UniquePtr<File> m_root;
+	InflateIndexCache m_inflateIndices;
 
 	prism::hashfs_header_t m_header;
 	Array<prism::hashfs_entry_t> m_entries;
+	HashIndex m_entryIndex;
+	SaltedPathHasher m_pathHasher;
 
 private:
 	bool readHashFS();
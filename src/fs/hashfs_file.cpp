@@ -26,27 +26,23 @@
 
 #include "hashfilesystem.h"
 
+#include "utils/compression.h"
+
 HashFsFile::HashFsFile(const String &filepath, HashFileSystem *filesystem, const prism::hashfs_entry_t *header)
 	: m_filepath(filepath)
 	, m_filesystem(filesystem)
 	, m_header(header)
 {
-	using namespace prism;
-
-	if (m_header->m_flags & HASHFS_COMPRESSED)
+	// inflate stream is created on first partial read, whole file reads do not need it
+	if ((m_header->m_flags & prism::HASHFS_COMPRESSED))
 	{
-		inflateInitialize();
+		m_inflateIndex = m_filesystem->inflateIndex(m_header->m_offset, m_header->m_size);
 	}
 }
 
 HashFsFile::~HashFsFile()
 {
-	using namespace prism;
-
-	if (m_header->m_flags & HASHFS_COMPRESSED)
-	{
-		inflateDestroy();
-	}
+	inflateDestroy();
 }
 
 uint64_t HashFsFile::write(const void *buffer, uint64_t elementSize, uint64_t elementCount)
@@ -82,6 +78,16 @@ uint64_t HashFsFile::read(void *buffer, uint64_t elementSize, uint64_t elementCo
 	}
 	else
 	{
+		if (m_positionCompressed == 0 && (elementSize * elementCount) >= m_header->m_size && readWhole(buffer))
+		{
+			return m_header->m_size;
+		}
+
+		if (!m_streamInitialized)
+		{
+			inflateInitialize();
+		}
+
 		const uint64_t chunk = 1024 * 4;
 		uint8_t inbuffer[chunk];
 		uint64_t bufferOffset = 0;
@@ -94,19 +100,29 @@ uint64_t HashFsFile::read(void *buffer, uint64_t elementSize, uint64_t elementCo
 				break;
 			}
 
-			if (!m_filesystem->ioRead(inbuffer, bytes, m_header->m_offset + m_positionCompressed ))
+			// inflate straight from the archive when it is mapped into memory
+			const void *input = m_filesystem->ioMap(left, m_header->m_offset + m_positionCompressed);
+			if (input)
+			{
+				bytes = std::min<uint64_t>(left, std::numeric_limits<decltype(m_stream.avail_in)>::max());
+			}
+			else if (m_filesystem->ioRead(inbuffer, bytes, m_header->m_offset + m_positionCompressed))
+			{
+				input = inbuffer;
+			}
+			else
 			{
 				error("hashfs", m_filepath, "Unable to read from filesystem file");
 				return 0;
 			}
 
 			m_stream.avail_in = static_cast<unsigned int>(bytes);
-			m_stream.next_in = inbuffer;
+			m_stream.next_in = (Bytef *)input;
 
 			m_stream.avail_out = static_cast<unsigned int>((elementSize * elementCount) - bufferOffset);
 			m_stream.next_out = (uint8_t *)buffer + bufferOffset;
 
-			int ret = inflate(&m_stream, Z_NO_FLUSH);
+			int ret = inflate(&m_stream, m_inflateIndex ? Z_BLOCK : Z_NO_FLUSH);
 			assert(ret != Z_STREAM_ERROR);
 
 			if (ret != Z_OK && ret != Z_STREAM_END)
@@ -120,6 +136,16 @@ uint64_t HashFsFile::read(void *buffer, uint64_t elementSize, uint64_t elementCo
 			m_position += wroteToBuffer;
 			assert(bufferOffset <= (elementSize * elementCount));
 			m_positionCompressed += (bytes - m_stream.avail_in);
+
+			if (ret == Z_STREAM_END)
+			{
+				m_positionCompressed = m_header->m_compressed_size; // stream resumed from checkpoint does not consume zlib trailer
+				break;
+			}
+			if (m_inflateIndex)
+			{
+				m_inflateIndex->update(m_stream, m_position, m_positionCompressed);
+			}
 		}
 		return bufferOffset;
 	}
@@ -134,18 +160,20 @@ bool HashFsFile::seek(uint64_t offset, Attrib attr)
 {
 	if (m_header->m_flags & prism::HASHFS_COMPRESSED)
 	{
-		if (offset == 0 && attr == SeekSet)
+		uint64_t position = m_position;
+		if (attr == SeekSet)
 		{
-			if ( m_positionCompressed != 0)
-			{
-				inflateDestroy();
-				inflateInitialize();
-			}
-			m_positionCompressed = 0;
-			m_position = 0;
-			return true;
+			position = offset;
+		}
+		else if (attr == SeekCur)
+		{
+			position += offset;
 		}
-		return false; // random access is not allowed
+		else if (attr == SeekEnd)
+		{
+			position = size() - offset;
+		}
+		return inflateSeek(position);
 	}
 	else
 	{
@@ -183,6 +211,88 @@ void HashFsFile::mstat( MetaStat *result )
 {
 }
 
+const void *HashFsFile::map(uint64_t offset, uint64_t size) const
+{
+	if ((m_header->m_flags & prism::HASHFS_COMPRESSED) || offset > m_header->m_size || size > m_header->m_size - offset)
+	{
+		return nullptr;
+	}
+	return m_filesystem->ioMap(size, m_header->m_offset + offset);
+}
+
+bool HashFsFile::copyRangeTo(File *output, uint64_t offset, uint64_t size)
+{
+	if ((m_header->m_flags & prism::HASHFS_COMPRESSED) || offset > m_header->m_size || size > m_header->m_size - offset)
+	{
+		return false;
+	}
+	return m_filesystem->ioCopy(output, size, m_header->m_offset + offset);
+}
+
+bool HashFsFile::readWhole(void *buffer)
+{
+	Array<u8> compressedBuffer;
+	const void *compressed = m_filesystem->ioMap(m_header->m_compressed_size, m_header->m_offset);
+	if (!compressed)
+	{
+		compressedBuffer.resize(static_cast<size_t>(m_header->m_compressed_size));
+		if (!m_filesystem->ioRead(compressedBuffer.data(), compressedBuffer.size(), m_header->m_offset))
+		{
+			return false;
+		}
+		compressed = compressedBuffer.data();
+	}
+
+	if (!unCompressWhole_zlib(buffer, m_header->m_size, compressed, m_header->m_compressed_size))
+	{
+		return false; // let the streaming path report the problem
+	}
+
+	inflateDestroy();
+	m_position = m_header->m_size;
+	m_positionCompressed = m_header->m_compressed_size;
+	return true;
+}
+
+bool HashFsFile::inflateSeek(uint64_t position)
+{
+	if (position > m_header->m_size)
+	{
+		return false;
+	}
+
+	const auto readByteAt = [this](uint64_t offset, u8 &byte)
+	{
+		if (!m_filesystem->ioRead(&byte, 1, m_header->m_offset + offset))
+		{
+			error("hashfs", m_filepath, "Unable to read from filesystem file");
+			return false;
+		}
+		return true;
+	};
+	const InflateIndex::SeekResult result = InflateIndex::seek(m_inflateIndex, m_stream, position, m_position, m_positionCompressed,
+		[this]() { inflateDestroy(); }, readByteAt);
+	if (result == InflateIndex::SeekResult::Failed)
+	{
+		error("hashfs", m_filepath, "Failed to resume inflate from checkpoint");
+		return false;
+	}
+	if (result == InflateIndex::SeekResult::Resumed)
+	{
+		m_streamInitialized = true;
+	}
+
+	Array<u8> skipBuffer(static_cast<size_t>(std::min<uint64_t>(position - m_position, 64 * 1024)));
+	while (m_position < position)
+	{
+		if (read(skipBuffer.data(), 1, std::min<uint64_t>(skipBuffer.size(), position - m_position)) == 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
 void HashFsFile::inflateInitialize()
 {
 	m_stream.zalloc = Z_NULL;
@@ -195,11 +305,16 @@ void HashFsFile::inflateInitialize()
 		error("hashfs", "", "Failed to inflate init");
 		return;
 	}
+	m_streamInitialized = true;
 }
 
 void HashFsFile::inflateDestroy()
 {
-	inflateEnd(&m_stream);
+	if (m_streamInitialized)
+	{
+		inflateEnd(&m_stream);
+		m_streamInitialized = false;
+	}
 }
 
 /* eof */
@@ -26,6 +26,8 @@
 
 #include <structs/hashfs.h>
 
+class InflateIndex;
+
 class HashFsFile : public File
 {
 public:
@@ -45,17 +47,24 @@ public:
 	virtual uint64_t tell() const override;
 	virtual void flush() override;
 	virtual void mstat( MetaStat *result ) override;
+	virtual const void *map(uint64_t offset, uint64_t size) const override;
+	virtual bool copyRangeTo(File *output, uint64_t offset, uint64_t size) override;
 
 private:
 	String			m_filepath;
 	HashFileSystem *m_filesystem;
 	z_stream		m_stream;
+	bool			m_streamInitialized = false;
+	InflateIndex *	m_inflateIndex = nullptr; // owned by filesystem, nullptr when checkpoints are not used
 	u64				m_position = 0;
 	u64				m_positionCompressed = 0;
 
 	const prism::hashfs_entry_t *m_header;
 
 private:
+	bool readWhole(void *buffer);
+	bool inflateSeek(uint64_t position); // resumes from the nearest checkpoint and inflates up to position
+
 	void inflateInitialize();
 	void inflateDestroy();
 
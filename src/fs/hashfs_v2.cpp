@@ -26,16 +26,20 @@
 
 #include "hashfs_v2_file.h"
 #include "sysfilesystem.h"
+#include "mount_index.h"
 #include "file.h"
 
 #include "utils/string_tokenizer.h"
 #include "utils/compression.h"
 #include "utils/token.h"
+#include "utils/thread_pool.h"
+
+#include "config.h"
 
 HashFsV2::HashFsV2( const String &root )
 {
 	m_rootFilename = root;
-	m_root = getSFS()->open( root, FileSystem::read | FileSystem::binary );
+	m_root = openArchiveRoot( root );
 	if( !m_root )
 	{
 		error( "hashfs_v2", root, "Unable to open root file" );
@@ -146,108 +150,170 @@ bool HashFsV2::dirExists( const String &dirpath )
 	return true;
 }
 
-auto HashFsV2::readDir( const String &path, bool absolutePaths, bool recursive ) -> UniquePtr<List<Entry>>
+namespace
+{
+	// listing blob: u32 count, u8 length of each name, names; directory names start with slash
+	template< typename F >
+	void parseDirectoryListing( const Array<u8> &buffer, F &&onItem )
+	{
+		const uint32_t countOfItems = interpretBufferAt<uint32_t>( buffer, 0 );
+
+		uint32_t currentLengthOffset = sizeof( uint32_t );
+		uint32_t currentStringOffset = currentLengthOffset + countOfItems * sizeof( uint8_t );
+
+		for( uint32_t i = 0; i < countOfItems; ++i )
+		{
+			const uint8_t pathLength = interpretBufferAt<uint8_t>( buffer, currentLengthOffset );
+			currentLengthOffset += sizeof( uint8_t );
+
+			StringView name( &interpretBufferAt<char>( buffer, currentStringOffset, pathLength ), size_t( pathLength ) );
+			currentStringOffset += pathLength;
+
+			const bool isDirectory = !name.empty() && name[ 0 ] == '/';
+			if( isDirectory )
+			{
+				name.remove_prefix( 1 );
+			}
+			onItem( name, isDirectory );
+		}
+	}
+
+	// shared by every archive preloading its directories, the mounting thread is one of the workers too
+	ThreadPool *directoryThreadPool()
+	{
+		static const UniquePtr<ThreadPool> pool = []() -> UniquePtr<ThreadPool>
+		{
+			const u32 workers = ThreadPool::hardwareConcurrency();
+			return workers > 1 ? std::make_unique<ThreadPool>( workers - 1 ) : nullptr;
+		}();
+		return pool.get();
+	}
+}
+
+bool HashFsV2::visitDir( const String &path, bool absolutePaths, bool recursive, const DirVisitor &visitor )
 {
 	if( path.empty() )
 	{
-		error( "hashfs_v2", m_rootFilename, "readDir: Path is empty!" );
-		return nullptr;
+		error( "hashfs_v2", m_rootFilename, "visitDir: Path is empty!" );
+		return false;
 	}
 
 	String dirpath = path.size() != 1 ? removeSlashAtEnd( path ) : path;
 
-	prism::hashfs_v2_entry_t *const entry = findEntry( dirpath );
-	if( entry == nullptr )
+	if( !m_directories.empty() )
 	{
-		error_f( "hashfs_v2", m_rootFilename, "Failed to open dirlist entry (%s)!", path );
-		return nullptr;
+		const u32 directory = m_directoryIndex.find( m_pathHasher( dirpath ) );
+		if( directory == HashIndex::NOT_FOUND )
+		{
+			error_f( "hashfs_v2", m_rootFilename, "Failed to open dirlist entry (%s)!", path );
+			return false;
+		}
+		visitDirectory( directory, removeSlashAtEnd( dirpath ) + "/", absolutePaths, recursive, visitor );
+		return true;
 	}
 
-	if( !( entry->m_flags & prism::hashfs_v2_entry_flags_t::directory ) )
+	prism::hashfs_v2_entry_t *const entry = findEntry( dirpath );
+	if( entry == nullptr )
 	{
-		error_f( "hashfs_v2", m_rootFilename, "Entry is not directory!" );
-		return nullptr;
+		error_f( "hashfs_v2", m_rootFilename, "Failed to open dirlist entry (%s)!", path );
+		return false;
 	}
 
-	const u32 *const plainMetadata = findMetadata( entry, prism::hashfs_v2_meta_t::directory );
-	if( plainMetadata == nullptr )
+	Array<u8> buffer;
+	if( !readDirectoryListing( entry, path, buffer ) )
 	{
-		error_f( "hashfs_v2", m_rootFilename, "Entry metadata is not available!" );
-		return nullptr;
+		return false;
 	}
 
-	prism::fs_meta_plain_t plainMetaValues = { 0 };
-	prism::hashfs_v2_meta_plain_get_value( plainMetadata, plainMetaValues );
+	const String prefix = removeSlashAtEnd( dirpath ) + "/";
 
-	HashFsV2File directoryFile( path, this, entry, plainMetaValues );
-
-	Array<u8> buffer( size_t( directoryFile.size() ) );
-	if( !directoryFile.blockRead( buffer.data(), 0, buffer.size() ) )
+	parseDirectoryListing( buffer, [ & ]( StringView name, bool isDirectory )
 	{
-		error_f( "hashfs_v2", m_rootFilename, "Entry could not be read!" );
-		return nullptr;
-	}
+		// entries of hashfs v2 carry no encryption flag
+		String entrypath;
+		entrypath.reserve( prefix.length() + name.length() );
+		if( absolutePaths )
+		{
+			entrypath.append( prefix );
+		}
+		entrypath.append( name );
 
-	const uint32_t countOfItems = interpretBufferAt<uint32_t>( buffer, 0 );
+		const Entry visited( std::move( entrypath ), isDirectory, false, this );
+		visitor( visited );
 
-	auto result = std::make_unique<List<Entry>>();
+		if( isDirectory && recursive )
+		{
+			visitDir( absolutePaths ? visited.GetPath() : prefix + visited.GetPath(), absolutePaths, recursive, visitor );
+		}
+	} );
 
-	uint32_t currentLengthOffset = sizeof( uint32_t );
-	uint32_t currentStringOffset = currentLengthOffset + countOfItems * sizeof( uint8_t );
+	return true;
+}
 
-	for( uint32_t i = 0; i < countOfItems; ++i )
+void HashFsV2::visitDirectory( u32 directory, const String &prefix, bool absolutePaths, bool recursive, const DirVisitor &visitor )
+{
+	const DirectoryNode &node = m_directories[ directory ];
+	for( u32 i = node.m_firstChild; i < node.m_firstChild + node.m_childCount; ++i )
 	{
-		const uint8_t pathLength = interpretBufferAt<uint8_t>( buffer, currentLengthOffset );
-		currentLengthOffset += sizeof( uint8_t );
-
-		const String path( &interpretBufferAt<char>( buffer, currentStringOffset, pathLength ), size_t( pathLength ) );
-		currentStringOffset += pathLength;
+		const DirectoryChild &child = m_directoryChildren[ i ];
+		const StringView name( m_directoryNames.data() + child.m_nameOffset, child.m_nameLength );
 
-		if( path[ 0 ] == '/' ) // directory
+		String entrypath;
+		entrypath.reserve( prefix.length() + name.length() );
+		if( absolutePaths )
 		{
-			String directorypath;
-			if( absolutePaths )
-			{
-				directorypath = removeSlashAtEnd( dirpath ) + "/" + String( path.c_str() + 1 );
-			}
-			else
-			{
-				directorypath = String( path.c_str() + 1 );
-			}
-			result->push_back( Entry( directorypath, true, false, this ) );
-
-			if( recursive )
-			{
-				auto subdir = readDir( directorypath, absolutePaths, recursive );
-				if( subdir )
-				{
-					result->insert( result->end(), subdir->begin(), subdir->end() );
-				}
-			}
+			entrypath.append( prefix );
 		}
-		else
+		entrypath.append( name );
+
+		const Entry visited( std::move( entrypath ), child.m_directory != 0, false, this );
+		visitor( visited );
+
+		if( child.m_directory && recursive )
 		{
-			String filepath;
-			if( absolutePaths )
-			{
-				filepath = removeSlashAtEnd( dirpath ) + "/" + path.c_str();
-			}
-			else
-			{
-				filepath = path;
-			}
+			String childPath;
+			childPath.reserve( prefix.length() + name.length() + 1 );
+			childPath.append( prefix ).append( name );
 
-			bool encrypted = false;
-			prism::hashfs_v2_entry_t *const entry = findEntry( removeSlashAtEnd( dirpath ) + "/" + path.c_str() );
-			if( entry )
+			const u32 childDirectory = m_directoryIndex.find( m_pathHasher( childPath ) );
+			if( childDirectory == HashIndex::NOT_FOUND )
 			{
-				//encrypted = !!(entry->m_flags & HASHFS_ENCRYPTED);
+				error_f( "hashfs_v2", m_rootFilename, "Failed to open dirlist entry (%s)!", childPath );
+				continue;
 			}
-			result->push_back( Entry( filepath, false, encrypted, this ) );
+			childPath.push_back( '/' );
+			visitDirectory( childDirectory, childPath, absolutePaths, recursive, visitor );
 		}
 	}
+}
+
+bool HashFsV2::readDirectoryListing( const prism::hashfs_v2_entry_t *entry, const String &path, Array<u8> &buffer )
+{
+	if( !( entry->m_flags & prism::hashfs_v2_entry_flags_t::directory ) )
+	{
+		error_f( "hashfs_v2", m_rootFilename, "Entry is not directory!" );
+		return false;
+	}
 
-	return result;
+	const u32 *const plainMetadata = findMetadata( entry, prism::hashfs_v2_meta_t::directory );
+	if( plainMetadata == nullptr )
+	{
+		error_f( "hashfs_v2", m_rootFilename, "Entry metadata is not available!" );
+		return false;
+	}
+
+	prism::fs_meta_plain_t plainMetaValues = { 0 };
+	prism::hashfs_v2_meta_plain_get_value( plainMetadata, plainMetaValues );
+
+	HashFsV2File directoryFile( path, this, entry, plainMetaValues );
+
+	buffer.resize( size_t( directoryFile.size() ) );
+	if( !directoryFile.blockRead( buffer.data(), 0, buffer.size() ) )
+	{
+		error_f( "hashfs_v2", m_rootFilename, "Entry could not be read!" );
+		return false;
+	}
+	return true;
 }
 
 bool HashFsV2::mstat( MetaStat *result, const String &path )
@@ -313,14 +379,255 @@ void HashFsV2::mstatEntry( MetaStat *result, const prism::hashfs_v2_entry_t *ent
 	} );
 }
 
+bool HashFsV2::visitEntryHashes( const std::function<void( u64 hash )> &visitor ) const
+{
+	if( m_header.m_salt != 0 )
+	{
+		return false;
+	}
+	for( const prism::hashfs_v2_entry_t &entry : m_entryTable )
+	{
+		visitor( entry.m_hash );
+	}
+	return true;
+}
+
+u64 HashFsV2::archiveOffset( const String &path )
+{
+	const prism::hashfs_v2_entry_t *const entry = findEntry( path );
+	if( entry == nullptr || !!( entry->m_flags & prism::hashfs_v2_entry_flags_t::directory ) )
+	{
+		return UINT64_MAX;
+	}
+
+	// packed tobjs have no plain record, their data is split into mips (same order as extractTextureObject)
+	const prism::hashfs_v2_meta_t metasToTry[] = { prism::hashfs_v2_meta_t::plain, prism::hashfs_v2_meta_t::mip0, prism::hashfs_v2_meta_t::mip1, prism::hashfs_v2_meta_t::miptail };
+	u64 offset = UINT64_MAX;
+	for( prism::hashfs_v2_meta_t meta : metasToTry )
+	{
+		const u32 *const plainMetadata = findMetadata( entry, meta );
+		if( plainMetadata == nullptr )
+		{
+			continue;
+		}
+
+		prism::fs_meta_plain_t plainMetaValues = { 0 };
+		prism::hashfs_v2_meta_plain_get_value( plainMetadata, plainMetaValues );
+		offset = std::min< u64 >( offset, plainMetaValues.get_offset() );
+	}
+	return offset;
+}
+
 bool HashFsV2::ioRead( void *const buffer, uint64_t bytes, uint64_t offset )
 {
-	return m_root->blockRead( buffer, offset, bytes );
+	countArchiveRead( bytes );
+	return m_root->readAt( buffer, offset, bytes );
+}
+
+const void *HashFsV2::ioMap( uint64_t bytes, uint64_t offset ) const
+{
+	const void *const mapped = m_root->map( offset, bytes );
+	if( mapped )
+	{
+		countArchiveRead( bytes );
+	}
+	return mapped;
+}
+
+bool HashFsV2::ioCopy( File *output, uint64_t bytes, uint64_t offset )
+{
+	if( !m_root->copyRangeTo( output, offset, bytes ) )
+	{
+		return false;
+	}
+	countArchiveRead( bytes );
+	return true;
+}
+
+namespace
+{
+	// sections: header, entry table, metadata table, optionally directory nodes, children and names
+	constexpr u32 MOUNT_INDEX_FORMAT = MAKEFOURCC( 'H', 'F', 'S', '2' );
 }
 
 bool HashFsV2::readHashFS()
 {
-	if( !m_root->blockRead( &m_header, 0, sizeof( prism::hashfs_v2_header_t ) ) )
+	const bool indexed = readMountIndex();
+	if( !indexed && !readTables() )
+	{
+		return false;
+	}
+
+	m_entryIndex.build( static_cast< u32 >( m_entryTable.size() ), [ this ]( u32 index ) { return m_entryTable[ index ].m_hash; } );
+	m_pathHasher = SaltedPathHasher( m_header.m_salt );
+
+	bool storeIndex = !indexed;
+	if( Config::s_preloadDirectories && m_directories.empty() )
+	{
+		if( preloadDirectories() )
+		{
+			storeIndex = true;
+		}
+		else
+		{
+			warning( "hashfs_v2", m_rootFilename, "Failed to preload directories, they will be read on demand!" );
+			m_directories.clear();
+			m_directoryChildren.clear();
+			m_directoryNames.clear();
+		}
+	}
+	m_directoryIndex.build( static_cast< u32 >( m_directories.size() ), [ this ]( u32 index ) { return m_directories[ index ].m_hash; } );
+
+	if( storeIndex )
+	{
+		writeMountIndex();
+	}
+
+	return true;
+}
+
+bool HashFsV2::preloadDirectories()
+{
+	Array<u32> directoryEntries;
+	for( u32 i = 0; i < static_cast< u32 >( m_entryTable.size() ); ++i )
+	{
+		if( !!( m_entryTable[ i ].m_flags & prism::hashfs_v2_entry_flags_t::directory ) )
+		{
+			directoryEntries.push_back( i );
+		}
+	}
+
+	// listings are decompressed in parallel, the tree itself is laid out afterwards in entry order
+	Array<Array<u8>> listings( directoryEntries.size() );
+	std::atomic<bool> failed = false;
+	const auto readListing = [ & ]( u32 index )
+	{
+		if( !readDirectoryListing( &m_entryTable[ directoryEntries[ index ] ], m_rootFilename, listings[ index ] ) )
+		{
+			failed = true;
+		}
+	};
+	if( ThreadPool *const pool = directoryEntries.size() > 1 ? directoryThreadPool() : nullptr )
+	{
+		pool->parallelFor( static_cast< u32 >( directoryEntries.size() ), readListing );
+	}
+	else
+	{
+		for( u32 i = 0; i < static_cast< u32 >( directoryEntries.size() ); ++i )
+		{
+			readListing( i );
+		}
+	}
+	if( failed )
+	{
+		return false;
+	}
+
+	size_t childCount = 0, namesSize = 0;
+	for( const Array<u8> &listing : listings )
+	{
+		if( listing.size() < sizeof( uint32_t ) )
+		{
+			return false;
+		}
+		const uint32_t countOfItems = interpretBufferAt<uint32_t>( listing, 0 );
+		if( listing.size() < sizeof( uint32_t ) + countOfItems ) // count and name length of each item
+		{
+			return false;
+		}
+		childCount += countOfItems;
+		namesSize += listing.size() - sizeof( uint32_t ) - countOfItems; // slashes of directories are not kept
+	}
+
+	m_directories.resize( directoryEntries.size() );
+	m_directoryChildren.clear();
+	m_directoryChildren.reserve( childCount );
+	m_directoryNames.clear();
+	m_directoryNames.reserve( namesSize );
+
+	for( size_t i = 0; i < directoryEntries.size(); ++i )
+	{
+		DirectoryNode &node = m_directories[ i ];
+		node.m_hash = m_entryTable[ directoryEntries[ i ] ].m_hash;
+		node.m_firstChild = static_cast< u32 >( m_directoryChildren.size() );
+		parseDirectoryListing( listings[ i ], [ this ]( StringView name, bool isDirectory )
+		{
+			DirectoryChild child;
+			child.m_nameOffset = static_cast< u32 >( m_directoryNames.size() );
+			child.m_nameLength = static_cast< u16 >( name.length() );
+			child.m_directory = isDirectory ? 1 : 0;
+			m_directoryChildren.push_back( child );
+			m_directoryNames.insert( m_directoryNames.end(), name.begin(), name.end() );
+		} );
+		node.m_childCount = static_cast< u32 >( m_directoryChildren.size() ) - node.m_firstChild;
+		Array<u8>().swap( listings[ i ] );
+	}
+	m_directoryNames.shrink_to_fit();
+	return true;
+}
+
+bool HashFsV2::readMountIndex()
+{
+	MountIndex index;
+	if( !index.load( m_rootFilename, MOUNT_INDEX_FORMAT ) )
+	{
+		return false;
+	}
+
+	uint64_t headerSize = 0;
+	const void *const header = index.section( 0, &headerSize );
+	if( header == nullptr || headerSize != sizeof( prism::hashfs_v2_header_t ) || !index.section( 1, m_entryTable ) || !index.section( 2, m_metadataTable ) )
+	{
+		warning( "hashfs_v2", m_rootFilename, "Mount index is corrupted, reading archive instead!" );
+		return false;
+	}
+	memcpy( &m_header, header, sizeof( prism::hashfs_v2_header_t ) );
+
+	// the tree is stored only by mounts with preloaded directories
+	if( Config::s_preloadDirectories && ( !index.section( 3, m_directories ) || !index.section( 4, m_directoryChildren ) || !index.section( 5, m_directoryNames ) ) )
+	{
+		m_directories.clear();
+		m_directoryChildren.clear();
+		m_directoryNames.clear();
+	}
+
+	// corrupted tree is rebuilt from the archive by preloadDirectories()
+	const auto nodeInvalid = [ this ]( const DirectoryNode &node )
+	{
+		return static_cast< u64 >( node.m_firstChild ) + node.m_childCount > m_directoryChildren.size();
+	};
+	const auto childInvalid = [ this ]( const DirectoryChild &child )
+	{
+		return static_cast< u64 >( child.m_nameOffset ) + child.m_nameLength > m_directoryNames.size();
+	};
+	if( std::any_of( m_directories.begin(), m_directories.end(), nodeInvalid ) || std::any_of( m_directoryChildren.begin(), m_directoryChildren.end(), childInvalid ) )
+	{
+		warning( "hashfs_v2", m_rootFilename, "Mount index directory tree is corrupted, reading directories from archive instead!" );
+		m_directories.clear();
+		m_directoryChildren.clear();
+		m_directoryNames.clear();
+	}
+	return true;
+}
+
+void HashFsV2::writeMountIndex() const
+{
+	MountIndex index;
+	index.addSection( &m_header, sizeof( prism::hashfs_v2_header_t ) );
+	index.addSection( m_entryTable );
+	index.addSection( m_metadataTable );
+	if( !m_directories.empty() )
+	{
+		index.addSection( m_directories );
+		index.addSection( m_directoryChildren );
+		index.addSection( m_directoryNames );
+	}
+	index.store( m_rootFilename, MOUNT_INDEX_FORMAT );
+}
+
+bool HashFsV2::readTables()
+{
+	if( !m_root->readAt( &m_header, 0, sizeof( prism::hashfs_v2_header_t ) ) )
 	{
 		error( "hashfs_v2", m_rootFilename, "Failed to read header!" );
 		return false;
@@ -346,7 +653,7 @@ bool HashFsV2::readHashFS()
 
 	if( entryTableSize == m_header.m_entry_table_compressed_size ) // entry table is not compressed
 	{
-		if( !m_root->blockRead( m_entryTable.data(), m_header.m_entry_table_offset, entryTableSize ) )
+		if( !m_root->readAt( m_entryTable.data(), m_header.m_entry_table_offset, entryTableSize ) )
 		{
 			error( "hashfs_v2", m_rootFilename, "Failed to read entry table!" );
 			return false;
@@ -355,7 +662,7 @@ bool HashFsV2::readHashFS()
 	else
 	{
 		Array<u8> compressedEntryTable( size_t( m_header.m_entry_table_compressed_size ) );
-		if( !m_root->blockRead( compressedEntryTable.data(), m_header.m_entry_table_offset, compressedEntryTable.size() ) )
+		if( !m_root->readAt( compressedEntryTable.data(), m_header.m_entry_table_offset, compressedEntryTable.size() ) )
 		{
 			error( "hashfs_v2", m_rootFilename, "Failed to read entry table!" );
 			return false;
@@ -373,7 +680,7 @@ bool HashFsV2::readHashFS()
 
 	if( metadataTableSize == m_header.m_metadata_table_compressed_size )
 	{
-		if( !m_root->blockRead( m_metadataTable.data(), m_header.m_metadata_table_offset, metadataTableSize ) )
+		if( !m_root->readAt( m_metadataTable.data(), m_header.m_metadata_table_offset, metadataTableSize ) )
 		{
 			error( "hashfs_v2", m_rootFilename, "Failed to read metadata table!" );
 			return false;
@@ -382,7 +689,7 @@ bool HashFsV2::readHashFS()
 	else
 	{
 		Array<u8> compressedMetadataTable( static_cast<size_t>( m_header.m_metadata_table_compressed_size ) );
-		if( !m_root->blockRead( compressedMetadataTable.data(), m_header.m_metadata_table_offset, compressedMetadataTable.size() ) )
+		if( !m_root->readAt( compressedMetadataTable.data(), m_header.m_metadata_table_offset, compressedMetadataTable.size() ) )
 		{
 			error( "hashfs_v2", m_rootFilename, "Failed to read metadata table!" );
 			return false;
@@ -424,43 +731,8 @@ void HashFsV2::walkMetadata( const prism::hashfs_v2_entry_t *entry, std::functio
 
 prism::hashfs_v2_entry_t *HashFsV2::findEntry( const String &path )
 {
-	if( m_entryTable.empty() )
-	{
-		return nullptr;
-	}
-
-	String pathToFind;
-	if( m_header.m_salt != 0 )
-	{
-		pathToFind = fmt::sprintf( "%u%s", m_header.m_salt, ( path.c_str() + 1 ) );
-	}
-	else
-	{
-		pathToFind = path.c_str() + 1;
-	}
-
-	const u64 hash = prism::city_hash_64( pathToFind.c_str(), pathToFind.length() );
-
-	for( s64 index, l = 0, r = m_entryTable.size() - 1; l <= r;) // binary search
-	{
-		index = l + ( r - l ) / 2;
-
-		if( m_entryTable[ static_cast< size_t >( index ) ].m_hash == hash )
-		{
-			return &m_entryTable[ static_cast< size_t >( index ) ];
-		}
-
-		if( m_entryTable[ static_cast< size_t >( index ) ].m_hash < hash )
-		{
-			l = index + 1;
-		}
-		else
-		{
-			r = index - 1;
-		}
-	}
-
-	return nullptr;
+	const u32 index = m_entryIndex.find( m_pathHasher( path ) );
+	return index != HashIndex::NOT_FOUND ? &m_entryTable[ index ] : nullptr;
 }
 
 prism::token_t HashFsV2::getMetaTokenName( prism::hashfs_v2_meta_t meta )
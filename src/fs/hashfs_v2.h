@@ -23,6 +23,8 @@
 #pragma once
 
 #include "filesystem.h"
+#include "inflate_index.h"
+#include "hash_index.h"
 
 #include "structs/hashfs_0x02.h"
 
@@ -45,12 +47,18 @@ public:
 	virtual bool rmdir( const String &directory ) override;
 	virtual bool exists( const String &filename ) override;
 	virtual bool dirExists( const String &dirpath ) override;
-	virtual UniquePtr<List<Entry>> readDir( const String &path, bool absolutePaths, bool recursive ) override;
+	virtual bool visitDir( const String &path, bool absolutePaths, bool recursive, const DirVisitor &visitor ) override;
 	virtual bool mstat( MetaStat *result, const String &path ) override;
+	virtual bool isReadOnly() const override { return true; }
+	virtual bool visitEntryHashes( const std::function<void( u64 hash )> &visitor ) const override;
+	virtual u64 archiveOffset( const String &path ) override;
 
 	virtual UniquePtr<File> openForReadingWithPlainMeta( const String &filename, const prism::fs_meta_plain_t &plainMetaValues, bool *outFileExists = nullptr ) override;
 
-	bool ioRead( void *const buffer, uint64_t bytes, uint64_t offset );
+	bool ioRead( void *const buffer, uint64_t bytes, uint64_t offset ); // safe to call from multiple threads
+	const void *ioMap( uint64_t bytes, uint64_t offset ) const; // nullptr when root is not memory mapped
+	bool ioCopy( File *output, uint64_t bytes, uint64_t offset ); // appends range of root to output inside the OS, false when not possible
+	InflateIndex *inflateIndex( uint64_t offset, uint64_t size ) { return m_inflateIndices.get( offset, size ); } // checkpoints of compressed stream at given offset
 
 	const u32 *findMetadata( const prism::hashfs_v2_entry_t *entry, prism::hashfs_v2_meta_t meta );
 	void walkMetadata( const prism::hashfs_v2_entry_t *entry, std::function< void( prism::hashfs_v2_meta_t meta, const uint32_t *metadata ) > f );
@@ -61,15 +69,42 @@ public:
 
 private:
 	bool readHashFS();
+	bool readTables(); // parses header, entry and metadata tables of the archive
+	bool readMountIndex(); // loads the same from persistent mount index, see Config::s_mountIndexDirectory
+	void writeMountIndex() const;
+	bool preloadDirectories(); // decodes listings of all directories into the tree, see Config::s_preloadDirectories
+	bool readDirectoryListing( const prism::hashfs_v2_entry_t *entry, const String &path, Array<u8> &buffer );
+	void visitDirectory( u32 directory, const String &prefix, bool absolutePaths, bool recursive, const DirVisitor &visitor );
 	prism::hashfs_v2_entry_t *findEntry( const String &path );
 
 private:
 	String m_rootFilename;
 	UniquePtr<File> m_root;
+	InflateIndexCache m_inflateIndices;
 
 	prism::hashfs_v2_header_t m_header;
 	Array<prism::hashfs_v2_entry_t> m_entryTable;
+	HashIndex m_entryIndex;
+	SaltedPathHasher m_pathHasher;
 	Array<u32> m_metadataTable;
+
+	// preloaded directory tree, empty when listings are read on demand
+	struct DirectoryNode
+	{
+		u64 m_hash;
+		u32 m_firstChild;
+		u32 m_childCount;
+	};
+	struct DirectoryChild
+	{
+		u32 m_nameOffset;
+		u16 m_nameLength;
+		u16 m_directory;
+	};
+	Array<DirectoryNode> m_directories;
+	Array<DirectoryChild> m_directoryChildren;
+	Array<char> m_directoryNames;
+	HashIndex m_directoryIndex;
 };
 
 /* eof */
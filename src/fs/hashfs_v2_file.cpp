@@ -26,6 +26,8 @@
 
 #include "hashfs_v2.h"
 
+#include "utils/compression.h"
+
 HashFsV2File::HashFsV2File( const String &filepath, HashFsV2 *filesystem, const prism::hashfs_v2_entry_t *entry, const prism::fs_meta_plain_t &plainMetaValues )
 	: m_filepath( filepath )
 	, m_filesystem( filesystem )
@@ -39,11 +41,12 @@ HashFsV2File::HashFsV2File( const String &filepath, HashFsV2 *filesystem, const
 	}
 	else if( m_compression == prism::fs_compression_t::zlib )
 	{
-		zlibInflateInitialize();
+		// inflate stream is created on first partial read, whole file reads do not need it
+		m_inflateIndex = m_filesystem->inflateIndex( plainMetaValues.get_offset(), plainMetaValues.get_size() );
 	}
 	else if( m_compression == prism::fs_compression_t::gdeflate )
 	{
-		gdeflateDecompressorInitialize();
+		// tile table is read on first partial read, whole file reads do not need it
 	}
 	else
 	{
@@ -67,7 +70,7 @@ HashFsV2File::~HashFsV2File()
 	}
 	else if( m_compression == prism::fs_compression_t::gdeflate )
 	{
-		gdeflateDecompressorDestroy();
+		// do nothing
 	}
 	else
 	{
@@ -108,6 +111,16 @@ uint64_t HashFsV2File::read( void *buffer, uint64_t elementSize, uint64_t elemen
 	}
 	else if( m_compression == prism::fs_compression_t::zlib )
 	{
+		if( m_positionCompressed == 0 && bytesCount >= m_size && zlibReadWhole( buffer ) )
+		{
+			return m_size;
+		}
+
+		if( !m_zlibStream )
+		{
+			zlibInflateInitialize();
+		}
+
 		const uint64_t chunk = 1024 * 4;
 		uint8_t inbuffer[ chunk ];
 		uint64_t bufferOffset = 0;
@@ -121,19 +134,29 @@ uint64_t HashFsV2File::read( void *buffer, uint64_t elementSize, uint64_t elemen
 				break;
 			}
 
-			if( !m_filesystem->ioRead( inbuffer, bytes, m_deviceOffset + m_positionCompressed ) )
+			// inflate straight from the archive when it is mapped into memory
+			const void *input = m_filesystem->ioMap( left, m_deviceOffset + m_positionCompressed );
+			if( input )
+			{
+				bytes = std::min< uint64_t >( left, std::numeric_limits< decltype( m_zlibStream->avail_in ) >::max() );
+			}
+			else if( m_filesystem->ioRead( inbuffer, bytes, m_deviceOffset + m_positionCompressed ) )
+			{
+				input = inbuffer;
+			}
+			else
 			{
 				error( "hashfs_v2", m_filepath, "Unable to read from filesystem file" );
 				return 0;
 			}
 
 			m_zlibStream->avail_in = static_cast< unsigned int >( bytes );
-			m_zlibStream->next_in = inbuffer;
+			m_zlibStream->next_in = const_cast< Bytef * >( static_cast< const Bytef * >( input ) );
 
 			m_zlibStream->avail_out = static_cast< unsigned int >( bytesCount - bufferOffset );
 			m_zlibStream->next_out = reinterpret_cast<uint8_t *>( buffer ) + bufferOffset;
 
-			int ret = inflate( m_zlibStream, Z_NO_FLUSH );
+			int ret = inflate( m_zlibStream, m_inflateIndex ? Z_BLOCK : Z_NO_FLUSH );
 			assert( ret != Z_STREAM_ERROR );
 
 			if( ret != Z_OK && ret != Z_STREAM_END )
@@ -147,30 +170,44 @@ uint64_t HashFsV2File::read( void *buffer, uint64_t elementSize, uint64_t elemen
 			m_position += wroteToBuffer;
 			assert( bufferOffset <= bytesCount );
 			m_positionCompressed += ( bytes - m_zlibStream->avail_in );
+
+			if( ret == Z_STREAM_END )
+			{
+				m_positionCompressed = m_compressedSize; // stream resumed from checkpoint does not consume zlib trailer
+				break;
+			}
+			if( m_inflateIndex )
+			{
+				m_inflateIndex->update( *m_zlibStream, m_position, m_positionCompressed );
+			}
 		}
 		return bufferOffset;
 	}
 	else if( m_compression == prism::fs_compression_t::gdeflate )
 	{
-		assert( m_position == 0 );
-		assert( bytesCount == m_size );
+		if( m_position != 0 || bytesCount < m_size )
+		{
+			return gdeflateRead( buffer, bytesCount );
+		}
 
-		Array< uint8_t > compressedBuffer( static_cast< size_t >( m_compressedSize ) );
-		if( !m_filesystem->ioRead( compressedBuffer.data(), m_compressedSize, m_deviceOffset ) )
+		Array< uint8_t > compressedBuffer;
+		const uint8_t *const compressed = readCompressed( compressedBuffer );
+		if( !compressed )
 		{
 			error( "hashfs_v2", m_filepath, "Unable to read from filesystem file" );
 			return 0;
 		}
 
-		if( !GDeflate::Decompress( reinterpret_cast< uint8_t * >( buffer ), size_t( bytesCount ), compressedBuffer.data(), compressedBuffer.size(), 1 ) )
+		// buffer may be larger than the file, the stream has to be decompressed to its exact size
+		if( !unCompress_gdeflate( buffer, m_size, compressed, m_compressedSize ) )
 		{
 			error( "hashfs_v2", m_filepath, "GDeflate returned error!" );
 			return 0;
 		}
 
-		m_position += bytesCount;
+		m_position = m_size;
 
-		return bytesCount;
+		return m_size;
 	}
 	else
 	{
@@ -204,31 +241,37 @@ bool HashFsV2File::seek( uint64_t offset, Attrib attr )
 	}
 	else if( m_compression == prism::fs_compression_t::zlib )
 	{
-		if( offset == 0 && attr == SeekSet )
+		uint64_t position = m_position;
+		if( attr == SeekSet )
 		{
-			if( m_positionCompressed != 0 )
-			{
-				zlibInflateDestroy();
-				zlibInflateInitialize();
-			}
-			m_positionCompressed = 0;
-			return true;
+			position = offset;
+		}
+		else if( attr == SeekCur )
+		{
+			position += offset;
 		}
-		return false; // random access is not allowed
+		else if( attr == SeekEnd )
+		{
+			position = size() - offset;
+		}
+		return zlibSeek( position );
 	}
 	else if( m_compression == prism::fs_compression_t::gdeflate )
 	{
-		if( offset == 0 && attr == SeekSet )
+		// tiles are independent, read decodes only those covering requested range
+		if( attr == SeekSet )
 		{
-			if( m_positionCompressed != 0 )
-			{
-				gdeflateDecompressorDestroy();
-				gdeflateDecompressorInitialize();
-			}
-			m_positionCompressed = 0;
-			return true;
+			m_position = offset;
+		}
+		else if( attr == SeekCur )
+		{
+			m_position += offset;
 		}
-		return false; // random access is not allowed
+		else if( attr == SeekEnd )
+		{
+			m_position = size() - offset;
+		}
+		return true;
 	}
 	else
 	{
@@ -256,6 +299,189 @@ void HashFsV2File::mstat( MetaStat *result )
 	m_filesystem->mstatEntry( result, m_entry );
 }
 
+const void *HashFsV2File::map( uint64_t offset, uint64_t size ) const
+{
+	if( m_compression != prism::fs_compression_t::nocompress || offset > m_size || size > m_size - offset )
+	{
+		return nullptr;
+	}
+	return m_filesystem->ioMap( size, m_deviceOffset + offset );
+}
+
+bool HashFsV2File::copyRangeTo( File *output, uint64_t offset, uint64_t size )
+{
+	if( m_compression != prism::fs_compression_t::nocompress || offset > m_size || size > m_size - offset )
+	{
+		return false;
+	}
+	return m_filesystem->ioCopy( output, size, m_deviceOffset + offset );
+}
+
+const uint8_t *HashFsV2File::readCompressed( Array< uint8_t > &storage )
+{
+	if( const void *const mapped = m_filesystem->ioMap( m_compressedSize, m_deviceOffset ) )
+	{
+		return static_cast< const uint8_t * >( mapped );
+	}
+
+	storage.resize( static_cast< size_t >( m_compressedSize ) );
+	if( !m_filesystem->ioRead( storage.data(), m_compressedSize, m_deviceOffset ) )
+	{
+		return nullptr;
+	}
+	return storage.data();
+}
+
+bool HashFsV2File::zlibReadWhole( void *buffer )
+{
+	Array< uint8_t > compressedBuffer;
+	const uint8_t *const compressed = readCompressed( compressedBuffer );
+	if( !compressed || !unCompressWhole_zlib( buffer, m_size, compressed, m_compressedSize ) )
+	{
+		return false; // let the streaming path report the problem
+	}
+
+	zlibInflateDestroy();
+	m_position = m_size;
+	m_positionCompressed = m_compressedSize;
+	return true;
+}
+
+bool HashFsV2File::gdeflateOpenTiles()
+{
+	uint8_t header[ GDeflateTileStream::HEADER_SIZE ];
+	if( m_compressedSize < sizeof( header ) || !m_filesystem->ioRead( header, sizeof( header ), m_deviceOffset ) )
+	{
+		return false;
+	}
+
+	const uint64_t tablesSize = GDeflateTileStream::tablesSize( header );
+	if( tablesSize == 0 || tablesSize > m_compressedSize )
+	{
+		return false;
+	}
+
+	Array< uint8_t > tables( static_cast< size_t >( tablesSize ) );
+	if( !m_filesystem->ioRead( tables.data(), tablesSize, m_deviceOffset ) )
+	{
+		return false;
+	}
+
+	auto stream = std::make_unique< GDeflateTileStream >();
+	if( !stream->parse( tables.data(), m_compressedSize ) || stream->uncompressedSize() != m_size )
+	{
+		return false;
+	}
+	m_gdeflateStream = std::move( stream );
+	return true;
+}
+
+bool HashFsV2File::gdeflateDecompressTile( u32 index, void *output )
+{
+	const uint64_t offset = m_gdeflateStream->tileOffset( index );
+	const u32 compressedSize = m_gdeflateStream->tileCompressedSize( index );
+
+	const void *tile = m_filesystem->ioMap( compressedSize, m_deviceOffset + offset );
+	if( !tile )
+	{
+		m_gdeflateCompressedTile.resize( compressedSize );
+		if( !m_filesystem->ioRead( m_gdeflateCompressedTile.data(), compressedSize, m_deviceOffset + offset ) )
+		{
+			return false;
+		}
+		tile = m_gdeflateCompressedTile.data();
+	}
+	return m_gdeflateStream->decompressTile( index, tile, output );
+}
+
+uint64_t HashFsV2File::gdeflateRead( void *buffer, uint64_t bytesCount )
+{
+	if( !m_gdeflateStream && !gdeflateOpenTiles() )
+	{
+		error( "hashfs_v2", m_filepath, "Invalid GDeflate tile stream!" );
+		return 0;
+	}
+
+	uint8_t *const output = static_cast< uint8_t * >( buffer );
+	uint64_t bufferOffset = 0;
+	while( bufferOffset < bytesCount && m_position < m_size )
+	{
+		const u32 tileIndex = static_cast< u32 >( m_position / GDeflateTileStream::TILE_SIZE );
+		const u32 tileSize = m_gdeflateStream->tileUncompressedSize( tileIndex );
+		const u32 tilePosition = static_cast< u32 >( m_position % GDeflateTileStream::TILE_SIZE );
+		const uint64_t bytes = std::min< uint64_t >( bytesCount - bufferOffset, tileSize - tilePosition );
+
+		if( tilePosition == 0 && bytes == tileSize )
+		{
+			// whole tile requested, decode it straight into the output
+			if( !gdeflateDecompressTile( tileIndex, output + bufferOffset ) )
+			{
+				error( "hashfs_v2", m_filepath, "GDeflate returned error!" );
+				return bufferOffset;
+			}
+		}
+		else
+		{
+			if( m_gdeflateTileIndex != tileIndex )
+			{
+				m_gdeflateTile.resize( tileSize );
+				if( !gdeflateDecompressTile( tileIndex, m_gdeflateTile.data() ) )
+				{
+					m_gdeflateTileIndex = UINT32_MAX;
+					error( "hashfs_v2", m_filepath, "GDeflate returned error!" );
+					return bufferOffset;
+				}
+				m_gdeflateTileIndex = tileIndex;
+			}
+			memcpy( output + bufferOffset, m_gdeflateTile.data() + tilePosition, static_cast< size_t >( bytes ) );
+		}
+
+		bufferOffset += bytes;
+		m_position += bytes;
+	}
+	return bufferOffset;
+}
+
+bool HashFsV2File::zlibSeek( uint64_t position )
+{
+	if( position > m_size )
+	{
+		return false;
+	}
+
+	const auto readByteAt = [ this ]( uint64_t offset, u8 &byte )
+	{
+		if( !m_filesystem->ioRead( &byte, 1, m_deviceOffset + offset ) )
+		{
+			error( "hashfs_v2", m_filepath, "Unable to read from filesystem file" );
+			return false;
+		}
+		return true;
+	};
+	auto stream = std::make_unique< z_stream >();
+	const InflateIndex::SeekResult result = InflateIndex::seek( m_inflateIndex, *stream, position, m_position, m_positionCompressed,
+		[ this ]() { zlibInflateDestroy(); }, readByteAt );
+	if( result == InflateIndex::SeekResult::Failed )
+	{
+		error( "hashfs_v2", m_filepath, "Failed to resume inflate from checkpoint" );
+		return false;
+	}
+	if( result == InflateIndex::SeekResult::Resumed )
+	{
+		m_zlibStream = stream.release();
+	}
+
+	Array< u8 > skipBuffer( static_cast< size_t >( std::min< uint64_t >( position - m_position, 64 * 1024 ) ) );
+	while( m_position < position )
+	{
+		if( read( skipBuffer.data(), 1, std::min< uint64_t >( skipBuffer.size(), position - m_position ) ) == 0 )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
 void HashFsV2File::zlibInflateInitialize()
 {
 	assert( m_zlibStream == nullptr );
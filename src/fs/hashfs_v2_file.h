@@ -26,9 +26,9 @@
 
 #include <structs/hashfs_0x02.h>
 
-#include "GDeflate.h"
-
 class HashFsV2;
+class GDeflateTileStream;
+class InflateIndex;
 
 class HashFsV2File : public File
 {
@@ -49,6 +49,8 @@ public:
 	virtual uint64_t tell() const override;
 	virtual void flush() override;
 	virtual void mstat( MetaStat *result ) override;
+	virtual const void *map( uint64_t offset, uint64_t size ) const override;
+	virtual bool copyRangeTo( File *output, uint64_t offset, uint64_t size ) override;
 
 private:
 	String			m_filepath;
@@ -65,13 +67,24 @@ private:
 	uint64_t m_deviceOffset = 0;
 
 	z_stream *m_zlibStream = nullptr;
+	InflateIndex *m_inflateIndex = nullptr; // owned by filesystem, nullptr when checkpoints are not used
+
+	UniquePtr< GDeflateTileStream > m_gdeflateStream; // tile table, loaded on first partial read
+	Array< uint8_t > m_gdeflateCompressedTile; // used when archive is not mapped
+	Array< uint8_t > m_gdeflateTile; // last decoded tile
+	u32 m_gdeflateTileIndex = UINT32_MAX;
 
 private:
+	const uint8_t *readCompressed( Array< uint8_t > &storage ); // returns whole compressed entry, storage is used when archive is not mapped
+	bool zlibReadWhole( void *buffer );
+	bool zlibSeek( uint64_t position ); // resumes from the nearest checkpoint and inflates up to position
+
 	void zlibInflateInitialize();
 	void zlibInflateDestroy();
 
-	inline void gdeflateDecompressorInitialize() {}
-	inline void gdeflateDecompressorDestroy() {}
+	bool gdeflateOpenTiles();
+	bool gdeflateDecompressTile( u32 index, void *output );
+	uint64_t gdeflateRead( void *buffer, uint64_t bytesCount );
 
 	//friend class HashFsV2;
 };
@@ -0,0 +1,139 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/inflate_index.cpp
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+#include <prerequisites.h>
+
+#include "inflate_index.h"
+
+#include "config.h"
+
+InflateIndex::InflateIndex(uint64_t interval)
+	: m_interval(interval)
+{
+}
+
+void InflateIndex::update(z_stream &stream, uint64_t position, uint64_t positionCompressed)
+{
+	// only at the end of block, which is not the last one - next block starts on known bit boundary
+	if (!(stream.data_type & 128) || (stream.data_type & 64))
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const uint64_t lastPosition = m_checkpoints.empty() ? 0 : m_checkpoints.back()->m_position;
+	if (position < lastPosition + m_interval)
+	{
+		return;
+	}
+
+	auto checkpoint = std::make_unique<Checkpoint>();
+	checkpoint->m_position = position;
+	checkpoint->m_positionCompressed = positionCompressed;
+	checkpoint->m_bits = stream.data_type & 7;
+	checkpoint->m_window.resize(32 * 1024);
+	uInt windowSize = static_cast<uInt>(checkpoint->m_window.size());
+	if (inflateGetDictionary(&stream, checkpoint->m_window.data(), &windowSize) != Z_OK)
+	{
+		return;
+	}
+	checkpoint->m_window.resize(windowSize);
+	m_checkpoints.push_back(std::move(checkpoint));
+}
+
+const InflateIndex::Checkpoint *InflateIndex::find(uint64_t position) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = std::upper_bound(m_checkpoints.begin(), m_checkpoints.end(), position,
+		[](uint64_t value, const UniquePtr<Checkpoint> &checkpoint) { return value < checkpoint->m_position; });
+	return it == m_checkpoints.begin() ? nullptr : (*std::prev(it)).get();
+}
+
+bool InflateIndex::resume(z_stream &stream, const Checkpoint &checkpoint, u8 previousByte)
+{
+	stream.zalloc = Z_NULL;
+	stream.zfree = Z_NULL;
+	stream.opaque = Z_NULL;
+	stream.avail_in = 0;
+	stream.next_in = Z_NULL;
+	if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+	{
+		return false;
+	}
+	if ((checkpoint.m_bits != 0 && inflatePrime(&stream, checkpoint.m_bits, previousByte >> (8 - checkpoint.m_bits)) != Z_OK)
+		|| inflateSetDictionary(&stream, checkpoint.m_window.data(), static_cast<uInt>(checkpoint.m_window.size())) != Z_OK)
+	{
+		inflateEnd(&stream);
+		return false;
+	}
+	return true;
+}
+
+InflateIndex::SeekResult InflateIndex::seek(const InflateIndex *index, z_stream &stream, uint64_t target, uint64_t &position, uint64_t &positionCompressed,
+	const std::function<void()> &end, const std::function<bool(uint64_t offset, u8 &byte)> &readByteAt)
+{
+	// going backward, or there is checkpoint ahead of current position
+	const Checkpoint *checkpoint = index ? index->find(target) : nullptr;
+	if (target >= position && (!checkpoint || checkpoint->m_position <= position))
+	{
+		return SeekResult::Forward;
+	}
+
+	end();
+	position = 0;
+	positionCompressed = 0;
+	if (!checkpoint)
+	{
+		return SeekResult::Forward;
+	}
+
+	// bits left over from the byte preceding the checkpoint
+	u8 previousByte = 0;
+	if (checkpoint->m_bits != 0 && !readByteAt(checkpoint->m_positionCompressed - 1, previousByte))
+	{
+		return SeekResult::Failed;
+	}
+	if (!resume(stream, *checkpoint, previousByte))
+	{
+		return SeekResult::Failed;
+	}
+	position = checkpoint->m_position;
+	positionCompressed = checkpoint->m_positionCompressed;
+	return SeekResult::Resumed;
+}
+
+InflateIndex *InflateIndexCache::get(uint64_t offset, uint64_t size)
+{
+	if (Config::s_inflateCheckpointInterval == 0 || size <= Config::s_inflateCheckpointInterval)
+	{
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	UniquePtr<InflateIndex> &index = m_indices[offset];
+	if (!index)
+	{
+		index = std::make_unique<InflateIndex>(Config::s_inflateCheckpointInterval);
+	}
+	return index.get();
+}
+
+/* eof */
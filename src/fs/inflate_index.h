@@ -0,0 +1,107 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/inflate_index.h
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+#pragma once
+
+/**
+ * @brief Checkpoints of single deflate stream
+ *
+ * While compressed archive entry is decoded, inflate state (position and 32 KB dictionary window)
+ * is saved at deflate block boundaries every Config::s_inflateCheckpointInterval bytes of output.
+ * Seeking then resumes inflation from the nearest checkpoint, so it costs at most one interval
+ * of re-inflation instead of decoding the entry from the beginning.
+ *
+ * Shared by every file opened for the same entry, safe to use from multiple threads.
+ */
+class InflateIndex
+{
+public:
+	struct Checkpoint
+	{
+		uint64_t m_position = 0; // uncompressed
+		uint64_t m_positionCompressed = 0; // first byte which was not fully consumed, relative to the start of the entry
+		u32 m_bits = 0; // number of bits of byte at m_positionCompressed - 1 which were not consumed yet
+		Array<u8> m_window;
+	};
+
+public:
+	explicit InflateIndex(uint64_t interval);
+
+	/**
+	 * @brief Records checkpoint if inflate(Z_BLOCK) has just stopped at the end of block and the interval has passed
+	 * @param[in] position Uncompressed position of the stream
+	 * @param[in] positionCompressed Number of compressed bytes consumed by the stream
+	 */
+	void update(z_stream &stream, uint64_t position, uint64_t positionCompressed);
+
+	/**
+	 * @brief Returns the last checkpoint not further than position or nullptr, checkpoints are never removed
+	 */
+	const Checkpoint *find(uint64_t position) const;
+
+	enum class SeekResult
+	{
+		Failed,
+		Forward, // keep inflating current stream, or start new one when position was reset to the start of the entry
+		Resumed, // stream was initialized as raw inflate stream continuing from checkpoint
+	};
+
+	/**
+	 * @brief Prepares decoding of the entry for seeking to target, the caller then inflates forward up to it
+	 *
+	 * When target is behind current position, or there is checkpoint between them, current stream is dropped
+	 * and decoding restarts from the nearest checkpoint, or from the start of the entry when there is none.
+	 * @param[in] index Checkpoints of the entry, may be nullptr
+	 * @param[out] stream Initialized in place when SeekResult::Resumed is returned
+	 * @param[in,out] position Uncompressed position of the stream
+	 * @param[in,out] positionCompressed Number of compressed bytes consumed by the stream
+	 * @param[in] end Drops current stream, called before stream is initialized
+	 * @param[in] readByteAt Reads byte of the entry at given compressed offset
+	 */
+	static SeekResult seek(const InflateIndex *index, z_stream &stream, uint64_t target, uint64_t &position, uint64_t &positionCompressed,
+		const std::function<void()> &end, const std::function<bool(uint64_t offset, u8 &byte)> &readByteAt);
+
+private:
+	static bool resume(z_stream &stream, const Checkpoint &checkpoint, u8 previousByte);
+
+private:
+	uint64_t m_interval;
+	mutable std::mutex m_mutex;
+	Array<UniquePtr<Checkpoint>> m_checkpoints;
+};
+
+/**
+ * @brief Inflate indices of entries of single archive, kept as long as the archive is mounted
+ */
+class InflateIndexCache
+{
+public:
+	/**
+	 * @brief Returns index of stream at given archive offset, nullptr when checkpoints are disabled or entry is too small to need them
+	 */
+	InflateIndex *get(uint64_t offset, uint64_t size);
+
+private:
+	std::mutex m_mutex;
+	Map<uint64_t, UniquePtr<InflateIndex>> m_indices;
+};
+
+/* eof */
@@ -0,0 +1,208 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/mapped_file.cpp
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+#include <prerequisites.h>
+
+#include "mapped_file.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#endif
+
+MappedFile::MappedFile()
+{
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const String &filePath)
+{
+	close();
+
+#ifdef _WIN32
+	m_file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(m_file, &fileSize) || fileSize.QuadPart == 0 || static_cast<uint64_t>(fileSize.QuadPart) > SIZE_MAX)
+	{
+		close();
+		return false;
+	}
+
+	m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!m_mapping)
+	{
+		close();
+		return false;
+	}
+
+	m_data = static_cast<const u8 *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!m_data)
+	{
+		close();
+		return false;
+	}
+	m_size = static_cast<uint64_t>(fileSize.QuadPart);
+#else
+	const int fd = ::open(filePath.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0 || static_cast<uint64_t>(st.st_size) > SIZE_MAX)
+	{
+		::close(fd);
+		return false;
+	}
+
+	void *const data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd); // mapping holds its own reference to the file
+	if (data == MAP_FAILED)
+	{
+		return false;
+	}
+
+	m_data = static_cast<const u8 *>(data);
+	m_size = static_cast<uint64_t>(st.st_size);
+#endif
+
+	m_position = 0;
+	return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (m_data)
+	{
+		UnmapViewOfFile(m_data);
+	}
+	if (m_mapping)
+	{
+		CloseHandle(m_mapping);
+		m_mapping = nullptr;
+	}
+	if (m_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_file);
+		m_file = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (m_data)
+	{
+		munmap(const_cast<u8 *>(m_data), static_cast<size_t>(m_size));
+	}
+#endif
+	m_data = nullptr;
+	m_size = 0;
+	m_position = 0;
+}
+
+uint64_t MappedFile::write(const void *buffer, uint64_t elementSize, uint64_t elementCount)
+{
+	return 0;
+}
+
+uint64_t MappedFile::read(void *buffer, uint64_t elementSize, uint64_t elementCount)
+{
+	if (elementSize == 0 || m_position >= m_size)
+	{
+		return 0;
+	}
+
+	const uint64_t count = std::min(elementCount, (m_size - m_position) / elementSize);
+	memcpy(buffer, m_data + m_position, static_cast<size_t>(count * elementSize));
+	m_position += count * elementSize;
+	return count;
+}
+
+uint64_t MappedFile::size()
+{
+	return m_size;
+}
+
+bool MappedFile::seek(uint64_t offset, Attrib attr)
+{
+	if (attr == SeekSet)
+	{
+		m_position = offset;
+	}
+	else if (attr == SeekCur)
+	{
+		m_position += offset;
+	}
+	else if (attr == SeekEnd)
+	{
+		m_position = m_size - offset;
+	}
+	return true;
+}
+
+void MappedFile::rewind()
+{
+	m_position = 0;
+}
+
+uint64_t MappedFile::tell() const
+{
+	return m_position;
+}
+
+void MappedFile::flush()
+{
+}
+
+void MappedFile::mstat( MetaStat *result )
+{
+}
+
+const void *MappedFile::map(uint64_t offset, uint64_t size) const
+{
+	if (!m_data || offset > m_size || size > m_size - offset)
+	{
+		return nullptr;
+	}
+	return m_data + offset;
+}
+
+bool MappedFile::readAt(void *buffer, uint64_t offset, uint64_t size)
+{
+	const void *const mapped = map(offset, size);
+	if (!mapped)
+	{
+		return false;
+	}
+	memcpy(buffer, mapped, static_cast<size_t>(size));
+	return true;
+}
+
+/* eof */
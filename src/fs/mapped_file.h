@@ -0,0 +1,69 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/mapped_file.h
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+#pragma once
+
+#include "file.h"
+
+/**
+ * @brief Read-only file mapped entirely into memory
+ *
+ * Used as root device of archive filesystems, so reading an entry becomes a memcpy
+ * (or no copy at all, when the caller is able to work on the mapped memory directly).
+ */
+class MappedFile : public File
+{
+public:
+	MappedFile();
+	MappedFile(const MappedFile &) = delete;
+	MappedFile(MappedFile &&) = delete;
+	virtual ~MappedFile();
+
+	MappedFile &operator=(const MappedFile &) = delete;
+	MappedFile &operator=(MappedFile &&) = delete;
+
+	bool open(const String &filePath);
+	void close();
+
+	virtual uint64_t write(const void *buffer, uint64_t elementSize, uint64_t elementCount) override;
+	virtual uint64_t read(void *buffer, uint64_t elementSize, uint64_t elementCount) override;
+	virtual uint64_t size() override;
+	virtual bool seek(uint64_t offset, Attrib attr) override;
+	virtual void rewind() override;
+	virtual uint64_t tell() const override;
+	virtual void flush() override;
+	virtual void mstat( MetaStat *result ) override;
+	virtual const void *map(uint64_t offset, uint64_t size) const override;
+	virtual bool readAt(void *buffer, uint64_t offset, uint64_t size) override;
+
+private:
+	const u8 *m_data = nullptr;
+	uint64_t m_size = 0;
+	uint64_t m_position = 0;
+
+#ifdef _WIN32
+	HANDLE m_file = INVALID_HANDLE_VALUE;
+	HANDLE m_mapping = nullptr;
+#endif
+};
+
+/* eof */
@@ -101,9 +101,9 @@ bool MemFileSystem::dirExists( const String &dirpath )
     else return false;
 }
 
-auto MemFileSystem::readDir( const String &path, bool absolutePaths, bool recursive ) -> UniquePtr<List<Entry>>
+bool MemFileSystem::visitDir( const String &path, bool absolutePaths, bool recursive, const DirVisitor &visitor )
 {
-    return nullptr; // not supported
+    return false; // not supported
 }
 
 bool MemFileSystem::mstat( MetaStat *result, const String &path )
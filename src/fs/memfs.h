@@ -21,7 +21,7 @@ public:
     virtual bool rmdir( const String &directory ) override;
     virtual bool exists( const String &filename ) override;
     virtual bool dirExists( const String &dirpath ) override;
-    virtual UniquePtr<List<Entry>> readDir( const String &path, bool absolutePaths, bool recursive ) override;
+    virtual bool visitDir( const String &path, bool absolutePaths, bool recursive, const DirVisitor &visitor ) override;
     virtual bool mstat( MetaStat *result, const String &path ) override;
 
 private:
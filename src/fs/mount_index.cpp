@@ -0,0 +1,259 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/mount_index.cpp
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+#include <prerequisites.h>
+
+#include "mount_index.h"
+
+#include "sysfilesystem.h"
+
+#include <config.h>
+
+#ifdef _WIN32
+#include <process.h>
+#endif
+
+namespace
+{
+	constexpr u32 MOUNT_INDEX_MAGIC = MAKEFOURCC('C', 'P', 'X', 'I');
+	constexpr u32 MOUNT_INDEX_VERSION = 1;
+	constexpr uint64_t MOUNT_INDEX_ALIGNMENT = 16;
+
+	struct MountIndexHeader
+	{
+		u32 m_magic;
+		u32 m_version;
+		u32 m_format;
+		u32 m_sectionCount;
+		u64 m_archiveSize;
+		u64 m_archiveModified;
+		u32 m_pathLength;
+		u32 m_reserved;
+		// followed by path, section table (offset and size of every section) and sections
+	};
+
+	struct MountIndexSection
+	{
+		u64 m_offset;
+		u64 m_size;
+	};
+
+	struct ArchiveKey
+	{
+		String m_path;
+		u64 m_size = 0;
+		u64 m_modified = 0;
+	};
+
+	uint64_t align(uint64_t value)
+	{
+		return (value + MOUNT_INDEX_ALIGNMENT - 1) & ~(MOUNT_INDEX_ALIGNMENT - 1);
+	}
+
+	bool archiveKey(const String &archivePath, ArchiveKey &key)
+	{
+	#ifdef _WIN32
+		char fullPath[MAX_PATH];
+		key.m_path = _fullpath(fullPath, archivePath.c_str(), MAX_PATH) ? fullPath : archivePath;
+
+		struct _stat64 st;
+		if (_stat64(key.m_path.c_str(), &st) != 0)
+		{
+			return false;
+		}
+		key.m_size = static_cast<u64>(st.st_size);
+		key.m_modified = static_cast<u64>(st.st_mtime);
+	#else
+		char *const fullPath = realpath(archivePath.c_str(), nullptr);
+		key.m_path = fullPath ? fullPath : archivePath;
+		free(fullPath);
+
+		struct stat st;
+		if (stat(key.m_path.c_str(), &st) != 0)
+		{
+			return false;
+		}
+		key.m_size = static_cast<u64>(st.st_size);
+		key.m_modified = static_cast<u64>(st.st_mtim.tv_sec) * 1000000000ull + static_cast<u64>(st.st_mtim.tv_nsec);
+	#endif
+		return true;
+	}
+
+	String indexPath(const ArchiveKey &key)
+	{
+		return fmt::sprintf("%s/%016llx.idx", removeSlashAtEnd(Config::s_mountIndexDirectory), prism::city_hash_64(key.m_path.c_str(), key.m_path.length()));
+	}
+}
+
+bool MountIndex::load(const String &archivePath, u32 format)
+{
+	ArchiveKey key;
+	if (Config::s_mountIndexDirectory.empty() || !archiveKey(archivePath, key))
+	{
+		return false;
+	}
+
+	if (!m_file.open(indexPath(key)))
+	{
+		return false;
+	}
+
+	const MountIndexHeader *const header = static_cast<const MountIndexHeader *>(m_file.map(0, sizeof(MountIndexHeader)));
+	if (!header
+	 || header->m_magic != MOUNT_INDEX_MAGIC
+	 || header->m_version != MOUNT_INDEX_VERSION
+	 || header->m_format != format
+	 || header->m_archiveSize != key.m_size
+	 || header->m_archiveModified != key.m_modified
+	 || header->m_pathLength != key.m_path.length())
+	{
+		m_file.close();
+		return false;
+	}
+
+	const char *const path = static_cast<const char *>(m_file.map(sizeof(MountIndexHeader), header->m_pathLength));
+	if (!path || memcmp(path, key.m_path.c_str(), header->m_pathLength) != 0) // hash of path collided
+	{
+		m_file.close();
+		return false;
+	}
+
+	const uint64_t sectionTableOffset = align(sizeof(MountIndexHeader) + header->m_pathLength);
+	m_sectionTable = static_cast<const u8 *>(m_file.map(sectionTableOffset, header->m_sectionCount * sizeof(MountIndexSection)));
+	if (!m_sectionTable)
+	{
+		m_file.close();
+		return false;
+	}
+	m_sectionCount = header->m_sectionCount;
+	return true;
+}
+
+const void *MountIndex::section(u32 index, uint64_t *outSize) const
+{
+	if (index >= m_sectionCount)
+	{
+		return nullptr;
+	}
+
+	MountIndexSection section;
+	memcpy(&section, m_sectionTable + index * sizeof(MountIndexSection), sizeof(MountIndexSection));
+
+	*outSize = section.m_size;
+	return m_file.map(section.m_offset, section.m_size);
+}
+
+void MountIndex::addSection(const void *data, uint64_t size)
+{
+	m_sections.emplace_back(data, size);
+}
+
+bool MountIndex::store(const String &archivePath, u32 format) const
+{
+	ArchiveKey key;
+	if (Config::s_mountIndexDirectory.empty() || !archiveKey(archivePath, key))
+	{
+		return false;
+	}
+
+	if (!getSFS()->mkdir(Config::s_mountIndexDirectory))
+	{
+		warning("system", Config::s_mountIndexDirectory, "Unable to create mount index directory!");
+		return false;
+	}
+
+	MountIndexHeader header = {};
+	header.m_magic = MOUNT_INDEX_MAGIC;
+	header.m_version = MOUNT_INDEX_VERSION;
+	header.m_format = format;
+	header.m_sectionCount = static_cast<u32>(m_sections.size());
+	header.m_archiveSize = key.m_size;
+	header.m_archiveModified = key.m_modified;
+	header.m_pathLength = static_cast<u32>(key.m_path.length());
+
+	const uint64_t sectionTableOffset = align(sizeof(MountIndexHeader) + header.m_pathLength);
+	Array<MountIndexSection> sectionTable(m_sections.size());
+	uint64_t offset = align(sectionTableOffset + sectionTable.size() * sizeof(MountIndexSection));
+	for (size_t i = 0; i < m_sections.size(); ++i)
+	{
+		sectionTable[i].m_offset = offset;
+		sectionTable[i].m_size = m_sections[i].second;
+		offset = align(offset + m_sections[i].second);
+	}
+
+	// written aside and renamed, so concurrently running instance never maps half written index
+	const String path = indexPath(key);
+#ifdef _WIN32
+	const String temporaryPath = fmt::sprintf("%s.%d.tmp", path, _getpid());
+#else
+	const String temporaryPath = fmt::sprintf("%s.%d.tmp", path, getpid());
+#endif
+	{
+		// written directly, so it is complete on disk before being renamed
+		UniquePtr<File> file = getSFS()->open(temporaryPath, FileSystem::write | FileSystem::binary | FileSystem::direct);
+		if (!file)
+		{
+			warning("system", temporaryPath, "Unable to write mount index!");
+			return false;
+		}
+
+		static const u8 padding[MOUNT_INDEX_ALIGNMENT] = {};
+		uint64_t position = 0;
+		auto write = [&](const void *data, uint64_t size, bool aligned)
+		{
+			uint64_t padded = aligned ? align(position + size) - position - size : 0;
+			if ((size > 0 && file->write(data, 1, size) != size) || (padded > 0 && file->write(padding, 1, padded) != padded))
+			{
+				return false;
+			}
+			position += size + padded;
+			return true;
+		};
+
+		bool written = write(&header, sizeof(header), false)
+			&& write(key.m_path.c_str(), key.m_path.length(), true)
+			&& write(sectionTable.data(), sectionTable.size() * sizeof(MountIndexSection), true);
+		for (size_t i = 0; written && i < m_sections.size(); ++i)
+		{
+			written = write(m_sections[i].first, m_sections[i].second, true);
+		}
+		if (!written)
+		{
+			file.reset();
+			std::remove(temporaryPath.c_str());
+			warning("system", temporaryPath, "Unable to write mount index!");
+			return false;
+		}
+	}
+
+#ifdef _WIN32
+	std::remove(path.c_str());
+#endif
+	if (std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+	{
+		std::remove(temporaryPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+/* eof */
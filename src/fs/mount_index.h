@@ -0,0 +1,92 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/mount_index.h
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+#pragma once
+
+#include "mapped_file.h"
+
+/**
+ * @brief Persistent on-disk cache of tables parsed when an archive is mounted
+ *
+ * Archive filesystem stores whatever it parsed (entry tables, metadata, directory tree) as sections
+ * of single file in Config::s_mountIndexDirectory. The file is keyed by archive path, size and
+ * modification time, so the next mount of unchanged archive maps it and validates the key
+ * instead of parsing (and inflating) the archive again.
+ */
+class MountIndex
+{
+public:
+	/**
+	 * @brief Maps index of the archive, false when the cache is disabled, index is missing or stale
+	 * @param[in] archivePath Path of the archive root file
+	 * @param[in] format Layout of sections, has to be changed whenever the layout changes
+	 */
+	bool load(const String &archivePath, u32 format);
+
+	/**
+	 * @brief Returns mapped section of loaded index, nullptr when there is no such section
+	 */
+	const void *section(u32 index, uint64_t *outSize) const;
+
+	/**
+	 * @brief Copies section of loaded index into array, false when size of section does not match element type
+	 */
+	template< typename T >
+	bool section(u32 index, Array<T> &out) const
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "sections are plain memory");
+		uint64_t size = 0;
+		const void *const data = section(index, &size);
+		if (!data || size % sizeof(T) != 0)
+		{
+			return false;
+		}
+		out.resize(static_cast<size_t>(size / sizeof(T)));
+		memcpy(out.data(), data, static_cast<size_t>(size));
+		return true;
+	}
+
+	/**
+	 * @brief Appends section to be stored, data has to stay alive until store() is called
+	 */
+	void addSection(const void *data, uint64_t size);
+
+	template< typename T >
+	void addSection(const Array<T> &array)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "sections are plain memory");
+		addSection(array.data(), array.size() * sizeof(T));
+	}
+
+	/**
+	 * @brief Writes added sections as index of the archive, does nothing when the cache is disabled
+	 */
+	bool store(const String &archivePath, u32 format) const;
+
+private:
+	MappedFile m_file;
+	const u8 *m_sectionTable = nullptr;
+	u32 m_sectionCount = 0;
+	Array<Pair<const void *, uint64_t>> m_sections; // to be stored
+};
+
+/* eof */
@@ -0,0 +1,122 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/path_pool.cpp
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+#include <prerequisites.h>
+
+#include "path_pool.h"
+
+PathPool::PathPool()
+{
+	clear();
+}
+
+u32 PathPool::add(u32 parent, StringView name)
+{
+	assert(parent < m_nodes.size());
+
+	Node node;
+	node.m_parent = parent;
+	node.m_nameOffset = static_cast<u32>(m_names.size());
+	node.m_nameLength = static_cast<u32>(name.length());
+	m_names.insert(m_names.end(), name.begin(), name.end());
+	m_nodes.push_back(node);
+	return static_cast<u32>(m_nodes.size() - 1);
+}
+
+String PathPool::path(u32 node) const
+{
+	if (node == ROOT)
+	{
+		return "/";
+	}
+
+	String result;
+	appendPath(node, result);
+	return result;
+}
+
+void PathPool::appendPath(u32 node, String &out) const
+{
+	if (node == ROOT)
+	{
+		return;
+	}
+
+	size_t length = 0;
+	for (u32 current = node; current != ROOT; current = m_nodes[current].m_parent)
+	{
+		length += 1 + m_nodes[current].m_nameLength;
+	}
+
+	// written backwards, from the node up to the root
+	const size_t begin = out.length();
+	out.resize(begin + length);
+	size_t end = out.length();
+	for (u32 current = node; current != ROOT; current = m_nodes[current].m_parent)
+	{
+		const Node &n = m_nodes[current];
+		end -= n.m_nameLength;
+		memcpy(&out[end], m_names.data() + n.m_nameOffset, n.m_nameLength);
+		out[--end] = '/';
+	}
+}
+
+void PathPool::reserve(size_t nodes, size_t nameBytes)
+{
+	m_nodes.reserve(nodes);
+	m_names.reserve(nameBytes);
+}
+
+void PathPool::shrinkToFit()
+{
+	m_nodes.shrink_to_fit();
+	m_names.shrink_to_fit();
+}
+
+void PathPool::clear()
+{
+	m_nodes.clear();
+	m_names.clear();
+	m_nodes.push_back(Node{ ROOT, 0, 0 });
+}
+
+bool PathPool::assign(Array<Node> nodes, Array<char> names)
+{
+	if (nodes.empty() || nodes[ROOT].m_nameLength != 0)
+	{
+		return false;
+	}
+	for (u32 i = 1; i < nodes.size(); ++i)
+	{
+		// parents precede their children, so walking up always ends at the root
+		if (nodes[i].m_parent >= i || u64(nodes[i].m_nameOffset) + nodes[i].m_nameLength > names.size())
+		{
+			return false;
+		}
+	}
+
+	m_nodes = std::move(nodes);
+	m_names = std::move(names);
+	return true;
+}
+
+/* eof */
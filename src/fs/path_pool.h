@@ -0,0 +1,90 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/path_pool.h
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+#pragma once
+
+/**
+ * @brief Arena of paths stored as tree of (parent, name) records
+ *
+ * Names of all nodes live in single buffer, so a tree of archive entries costs
+ * one record per entry instead of separate strings of its full path and name.
+ * Full path is rebuilt only when asked for.
+ */
+class PathPool
+{
+public:
+	static constexpr u32 ROOT = 0; // node of "/", has empty name
+
+	struct Node
+	{
+		u32 m_parent;
+		u32 m_nameOffset;
+		u32 m_nameLength;
+	};
+
+public:
+	PathPool();
+
+	/**
+	 * @brief Adds node of given name under parent, returns its index
+	 */
+	u32 add(u32 parent, StringView name);
+
+	u32 parent(u32 node) const { return m_nodes[node].m_parent; }
+	StringView name(u32 node) const { return StringView(m_names.data() + m_nodes[node].m_nameOffset, m_nodes[node].m_nameLength); }
+
+	/**
+	 * @brief Returns absolute path of node, "/" for root
+	 */
+	String path(u32 node) const;
+
+	/**
+	 * @brief Appends "/name" of every node on the way from root to node
+	 */
+	void appendPath(u32 node, String &out) const;
+
+	u32 size() const { return static_cast<u32>(m_nodes.size()); }
+
+	/**
+	 * @brief Number of bytes held by the pool
+	 */
+	size_t memoryUsage() const { return m_nodes.capacity() * sizeof(Node) + m_names.capacity(); }
+
+	void reserve(size_t nodes, size_t nameBytes);
+	void shrinkToFit();
+	void clear();
+
+	// plain arrays, used for serialization
+	const Array<Node> &nodes() const { return m_nodes; }
+	const Array<char> &names() const { return m_names; }
+
+	/**
+	 * @brief Replaces contents with previously serialized arrays, false when they are inconsistent
+	 */
+	bool assign(Array<Node> nodes, Array<char> names);
+
+private:
+	Array<Node> m_nodes;
+	Array<char> m_names;
+};
+
+/* eof */
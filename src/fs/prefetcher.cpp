@@ -0,0 +1,130 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/prefetcher.cpp
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+#include <prerequisites.h>
+
+#include "prefetcher.h"
+
+#include "file.h"
+#include "uberfilesystem.h"
+
+#include <config.h>
+
+Prefetcher::Prefetcher(UberFileSystem *filesystem)
+	: m_filesystem(filesystem)
+{
+	m_thread = std::thread(&Prefetcher::prefetcherMain, this);
+}
+
+Prefetcher::~Prefetcher()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_changed.notify_all();
+	m_thread.join();
+
+	for (const auto &held : m_held)
+	{
+		for (const String &path : held.second.m_pinned)
+		{
+			m_filesystem->unpin(path);
+		}
+	}
+}
+
+Prefetcher::Ticket Prefetcher::request(Array<String> paths)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const Ticket ticket = m_nextTicket++;
+	m_queue.push_back({ ticket, std::move(paths) });
+	m_changed.notify_all();
+	return ticket;
+}
+
+void Prefetcher::release(Ticket ticket)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto held = m_held.find(ticket);
+	if (held != m_held.end())
+	{
+		for (const String &path : held->second.m_pinned)
+		{
+			m_filesystem->unpin(path);
+		}
+		m_bytes -= held->second.m_bytes;
+		m_held.erase(held);
+	}
+	else
+	{
+		m_queue.remove_if([ticket](const Request &request) { return request.m_ticket == ticket; });
+	}
+	m_changed.notify_all();
+}
+
+void Prefetcher::prefetcherMain()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;)
+	{
+		m_changed.wait(lock, [&] { return m_stop || !m_queue.empty(); });
+		if (m_stop)
+		{
+			return;
+		}
+
+		Request request = std::move(m_queue.front());
+		m_queue.pop_front();
+		m_held[request.m_ticket] = Group();
+
+		for (const String &path : request.m_paths)
+		{
+			m_changed.wait(lock, [&] { return m_stop || m_bytes < Config::s_prefetchSize; });
+			auto group = m_held.find(request.m_ticket);
+			if (m_stop || group == m_held.end())
+			{
+				break; // released while being read
+			}
+			// pinned before it is read, so it stays cached until the group is released
+			const bool pinned = m_filesystem->pin(path);
+			if (pinned)
+			{
+				group->second.m_pinned.push_back(path);
+			}
+			lock.unlock();
+
+			Array<u8> contents;
+			const UniquePtr<File> file = m_filesystem->open(path, FileSystem::read | FileSystem::binary);
+			const bool read = file && file->size() <= Config::s_fileCacheSize && file->getContents(contents);
+
+			lock.lock();
+			auto held = m_held.find(request.m_ticket);
+			if (read && pinned && held != m_held.end())
+			{
+				held->second.m_bytes += contents.size();
+				m_bytes += contents.size();
+			}
+		}
+	}
+}
+
+/* eof */
@@ -0,0 +1,82 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/prefetcher.h
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+#pragma once
+
+#include "filesystem.h"
+
+/**
+ * @brief Reads files ahead of their use on a dedicated thread, so they are served from the file cache
+ *
+ * Files are requested in groups (e.g. every file of single model). Group is read whole through the
+ * filesystem, which decompresses it and stores it in its FileCache, and its entries stay pinned there
+ * until released by the consumer. Bytes of held groups are limited by Config::s_prefetchSize, prefetching
+ * waits for releases when the budget is used up. Group released before it was read is skipped.
+ */
+class Prefetcher
+{
+public:
+	using Ticket = u64;
+
+public:
+	explicit Prefetcher(UberFileSystem *filesystem);
+	~Prefetcher();
+	Prefetcher(const Prefetcher &) = delete;
+	Prefetcher &operator=(const Prefetcher &) = delete;
+
+	/**
+	 * @brief Queues files to be read, missing ones are skipped
+	 */
+	Ticket request(Array<String> paths);
+
+	/**
+	 * @brief Tells that files of the group are not needed anymore, the group does not count towards the budget after that
+	 */
+	void release(Ticket ticket);
+
+private:
+	struct Request
+	{
+		Ticket m_ticket;
+		Array<String> m_paths;
+	};
+
+	struct Group
+	{
+		u64 m_bytes = 0;
+		Array<String> m_pinned;
+	};
+
+	void prefetcherMain();
+
+private:
+	UberFileSystem *m_filesystem;
+	std::mutex m_mutex;
+	std::condition_variable m_changed;
+	List<Request> m_queue;
+	Map<Ticket, Group> m_held; // groups being read or already read
+	u64 m_bytes = 0; // sum of bytes of held groups
+	Ticket m_nextTicket = 0;
+	bool m_stop = false;
+	std::thread m_thread;
+};
+
+/* eof */
@@ -25,8 +25,16 @@
 #include "sysfilesystem.h"
 
 #include "sysfs_file.h"
+#include "write_behind.h"
 
 #include "utils/string_utils.h"
+#include "utils/thread_pool.h"
+
+#include "config.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#endif
 
 SysFileSystem::SysFileSystem( const String &root )
 	: m_root( root )
@@ -53,6 +61,12 @@ UniquePtr<File> SysFileSystem::open( const String &filePath, FsOpenMode mode, bo
 {
 	const String builtFilePath = buildPath( filePath );
 
+	if( Config::s_writeBehindSize > 0 )
+	{
+		// it might be still written: reading would see it incomplete, writing would truncate it under the writer thread
+		getWriteBehindQueue()->wait( builtFilePath );
+	}
+
 	if( outFileExists )
 	{
 		if( fileExistsStatic( builtFilePath ) )
@@ -99,7 +113,13 @@ UniquePtr<File> SysFileSystem::open( const String &filePath, FsOpenMode mode, bo
 
 	auto file = std::make_unique<SysFsFile>();
 	file->m_fp = fp;
+	file->m_path = builtFilePath;
 	fseek( file->m_fp, 0, SEEK_SET );
+	if( ( mode & write ) && !( mode & ( read | append | update | direct ) ) && Config::s_writeBehindSize > 0 )
+	{
+		file->m_writeBehind = true;
+		file->m_buffer.reserve( 64 * 1024 );
+	}
 	return std::move( file );
 }
 
@@ -123,10 +143,10 @@ bool SysFileSystem::mkdir(const String &dir)
 		if( !dirExistsStatic( dirr.substr( 0, pos ).c_str() ) )
 		{
 		#ifdef _WIN32
-			if( ::mkdir( dirr.substr( 0, pos ).c_str() ) != 0 )
+			if( ::mkdir( dirr.substr( 0, pos ).c_str() ) != 0 && errno != EEXIST ) // may be created concurrently by other thread
 				return false;
 		#else
-			if( ::mkdir( dirr.substr( 0, pos ).c_str(), 0775 ) != 0 )
+			if( ::mkdir( dirr.substr( 0, pos ).c_str(), 0775 ) != 0 && errno != EEXIST ) // may be created concurrently by other thread
 				return false;
 		#endif
 		}
@@ -149,7 +169,7 @@ bool SysFileSystem::dirExists( const String &dirpath )
 	return dirExistsStatic( buildPath( dirpath ) );
 }
 
-auto SysFileSystem::readDir(const String &directory, bool absolutePaths, bool recursive) -> UniquePtr<List<Entry>>
+bool SysFileSystem::visitDir(const String &directory, bool absolutePaths, bool recursive, const DirVisitor &visitor)
 {
 	const String directoryNoSlash = trimSlashesAtEnd( directory );
 
@@ -158,9 +178,8 @@ auto SysFileSystem::readDir(const String &directory, bool absolutePaths, bool re
 	WIN32_FIND_DATA fileData;
 
 	if ((dir = FindFirstFileA((buildPath(directoryNoSlash) + "/*").c_str(), &fileData)) == INVALID_HANDLE_VALUE)
-		return UniquePtr<List<Entry>>();
+		return false;
 
-	auto result = std::make_unique<List<Entry>>();
 	do
 	{
 		const String fileName = fileData.cFileName;
@@ -174,53 +193,210 @@ auto SysFileSystem::readDir(const String &directory, bool absolutePaths, bool re
 		{
 			if (recursive)
 			{
-				auto subdir = readDir(fullFileName, absolutePaths, recursive);
-				if (subdir)
-				{
-					result->insert(result->end(), subdir->begin(), subdir->end());
-				}
+				visitDir(fullFileName, absolutePaths, recursive, visitor);
 			}
 		}
-		result->push_back(Entry((absolutePaths ? fullFileName : fileName), isDirectory, false, this));
+		visitor(Entry((absolutePaths ? fullFileName : fileName), isDirectory, false, this));
 	} while (FindNextFileA(dir, &fileData));
 	FindClose(dir);
-	return result;
+	return true;
 #else
-	auto result = std::make_unique<List<Entry>>();
-	DIR *dir;
-	struct dirent *ent;
-	struct stat st;
+	const int fd = ::open(buildPath(directoryNoSlash).c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd == -1)
+		return false;
 
-	dir = opendir(buildPath(directoryNoSlash).c_str());
-	while ((ent = readdir(dir)) != 0)
+	if (!recursive || Config::s_directoryWalkers <= 1)
 	{
-		const String fileName = ent->d_name;
-		const String fullFileName = directoryNoSlash + "/" + fileName;
+		walkDirectory(fd, directoryNoSlash, absolutePaths, recursive, visitor);
+		return true;
+	}
 
-		if (fileName[0] == '.')
-			continue;
+	walkDirectoryParallel(fd, directoryNoSlash, absolutePaths, visitor);
+	return true;
+#endif
+}
 
-		if (stat(buildPath(fullFileName).c_str(), &st) == -1)
+#ifndef _WIN32
+void SysFileSystem::walkDirectory(int fd, const String &directory, bool absolutePaths, bool recursive, const DirVisitor &visitor)
+{
+	DIR *const dir = fdopendir(fd);
+	if (!dir)
+	{
+		::close(fd);
+		return;
+	}
+
+	const String prefix = directory + "/";
+
+	struct dirent *ent;
+	while ((ent = readdir(dir)) != 0)
+	{
+		if (ent->d_name[0] == '.')
 			continue;
 
-		const bool isDirectory = !!(st.st_mode & S_IFDIR);
-		if (isDirectory)
+		// type reported by readdir is enough unless the filesystem does not fill it or the entry is a symlink
+		bool isDirectory = ent->d_type == DT_DIR;
+		if (ent->d_type == DT_UNKNOWN || ent->d_type == DT_LNK)
 		{
-			if (recursive)
+			struct stat st;
+			if (fstatat(dirfd(dir), ent->d_name, &st, 0) == -1)
+				continue;
+			isDirectory = S_ISDIR(st.st_mode);
+		}
+
+		String fullFileName;
+		if (absolutePaths || (isDirectory && recursive))
+		{
+			fullFileName.reserve(prefix.length() + strlen(ent->d_name));
+			fullFileName.append(prefix).append(ent->d_name);
+		}
+
+		if (isDirectory && recursive)
+		{
+			const int subdirectoryFd = openat(dirfd(dir), ent->d_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+			if (subdirectoryFd != -1)
 			{
-				auto subdir = readDir(fullFileName, absolutePaths, recursive);
-				if (subdir)
+				walkDirectory(subdirectoryFd, fullFileName, absolutePaths, recursive, visitor);
+			}
+		}
+		visitor(Entry(absolutePaths ? std::move(fullFileName) : String(ent->d_name), isDirectory, false, this));
+	}
+	closedir(dir);
+}
+
+void SysFileSystem::walkDirectoryParallel(int fd, const String &directory, bool absolutePaths, const DirVisitor &visitor)
+{
+	// listings of single directories are read ahead by the workers, the visitor is called from this thread in the order
+	// of the sequential walk; at most readAhead listings wait to be visited besides one listing per level of the walked path
+	struct Listing
+	{
+		String m_directory;
+		int m_fd = -1; // kept open while children may be opened relative to it
+		Array<Pair<String, bool>> m_children; // name, is directory
+		bool m_ready = false;
+
+		~Listing()
+		{
+			if (m_fd != -1)
+				::close(m_fd);
+		}
+	};
+	struct Level
+	{
+		SharedPtr<Listing> m_listing;
+		Array<SharedPtr<Listing>> m_subdirectories; // read ahead listings of children, indexed as children
+		size_t m_next = 0; // child to be visited
+		size_t m_nextReadAhead = 0; // child to be considered for reading ahead
+	};
+
+	const auto list = [this](int directoryFd, Listing &listing)
+	{
+		listing.m_fd = directoryFd;
+		if (directoryFd != -1)
+		{
+			walkDirectory(fcntl(directoryFd, F_DUPFD_CLOEXEC, 0), listing.m_directory, false, false, [&](const Entry &entry)
+			{
+				listing.m_children.emplace_back(entry.GetPath(), entry.IsDirectory());
+			});
+		}
+	};
+
+	const size_t readAhead = static_cast<size_t>(Config::s_directoryWalkers) * 4;
+	size_t pending = 0; // listings read ahead but not visited yet
+	std::mutex mutex;
+	std::condition_variable listingReady;
+	ThreadPool pool(Config::s_directoryWalkers - 1);
+
+	const auto readAheadListings = [&](Array<Level> &levels)
+	{
+		// the deepest level is visited first
+		for (auto level = levels.rbegin(); level != levels.rend() && pending < readAhead; ++level)
+		{
+			const Array<Pair<String, bool>> &children = level->m_listing->m_children;
+			level->m_nextReadAhead = std::max(level->m_nextReadAhead, level->m_next);
+			for (; level->m_nextReadAhead < children.size() && pending < readAhead; ++level->m_nextReadAhead)
+			{
+				if (!children[level->m_nextReadAhead].second)
 				{
-					result->insert(result->begin(), subdir->begin(), subdir->end());
+					continue;
 				}
+				const String &name = children[level->m_nextReadAhead].first;
+				auto listing = std::make_shared<Listing>();
+				listing->m_directory = level->m_listing->m_directory + "/" + name;
+				level->m_subdirectories[level->m_nextReadAhead] = listing;
+				++pending;
+				// the parent listing stays on the walked path until this one is visited, so its descriptor outlives the task
+				pool.submit([&, listing, parentFd = level->m_listing->m_fd, name]()
+				{
+					list(parentFd == -1 ? -1 : openat(parentFd, name.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC), *listing);
+					std::lock_guard<std::mutex> lock(mutex);
+					listing->m_ready = true;
+					listingReady.notify_all();
+				});
+			}
+		}
+	};
+
+	const auto enter = [](Array<Level> &levels, SharedPtr<Listing> listing)
+	{
+		Level level;
+		level.m_subdirectories.resize(listing->m_children.size());
+		level.m_listing = std::move(listing);
+		levels.push_back(std::move(level));
+	};
+
+	Array<Level> levels;
+	{
+		auto root = std::make_shared<Listing>();
+		root->m_directory = directory;
+		list(fd, *root);
+		enter(levels, std::move(root));
+	}
+	while (!levels.empty())
+	{
+		readAheadListings(levels);
+
+		Level &level = levels.back();
+		if (level.m_next == level.m_listing->m_children.size())
+		{
+			// entry of the directory follows its subtree
+			levels.pop_back();
+			if (!levels.empty())
+			{
+				const Level &parent = levels.back();
+				const Listing &parentListing = *parent.m_listing;
+				const String &name = parentListing.m_children[parent.m_next - 1].first;
+				visitor(Entry(absolutePaths ? parentListing.m_directory + "/" + name : name, true, false, this));
 			}
+			continue;
 		}
-		result->push_back(Entry((absolutePaths ? fullFileName : fileName), isDirectory, false, this));
+
+		const size_t index = level.m_next++;
+		const Pair<String, bool> &child = level.m_listing->m_children[index];
+		if (!child.second)
+		{
+			visitor(Entry(absolutePaths ? level.m_listing->m_directory + "/" + child.first : child.first, false, false, this));
+			continue;
+		}
+
+		SharedPtr<Listing> listing = std::move(level.m_subdirectories[index]);
+		if (listing)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			listingReady.wait(lock, [&]() { return listing->m_ready; });
+			--pending;
+		}
+		else
+		{
+			listing = std::make_shared<Listing>();
+			listing->m_directory = level.m_listing->m_directory + "/" + child.first;
+			const int parentFd = level.m_listing->m_fd;
+			list(parentFd == -1 ? -1 : openat(parentFd, child.first.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC), *listing);
+		}
+		enter(levels, std::move(listing));
 	}
-	closedir(dir);
-	return result;
-#endif
 }
+#endif
 
 bool SysFileSystem::mstat( MetaStat *result, const String &path )
 {
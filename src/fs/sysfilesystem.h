@@ -38,7 +38,7 @@ public:
 	virtual bool rmdir(const String &directory) override;
 	virtual bool exists(const String &filename) override;
 	virtual bool dirExists(const String &dirpath) override;
-	virtual UniquePtr<List<Entry>> readDir(const String &path, bool absolutePaths, bool recursive) override;
+	virtual bool visitDir(const String &path, bool absolutePaths, bool recursive, const DirVisitor &visitor) override;
 	virtual bool mstat( MetaStat *result, const String &path ) override;
 
 	String getError() const;
@@ -49,6 +49,10 @@ private:
 
 private:
 	String buildPath( const String &path ) const;
+#ifndef _WIN32
+	void walkDirectory(int fd, const String &directory, bool absolutePaths, bool recursive, const DirVisitor &visitor); // takes ownership of fd
+	void walkDirectoryParallel(int fd, const String &directory, bool absolutePaths, const DirVisitor &visitor); // takes ownership of fd
+#endif
 
 private:
 	String m_root; // if it is not empty, it must contain slash at the end
@@ -23,6 +23,13 @@
 #include <prerequisites.h>
 
 #include "sysfs_file.h"
+#include "write_behind.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/sendfile.h>
+#endif
 
 SysFsFile::SysFsFile()
 {
@@ -30,7 +37,11 @@ SysFsFile::SysFsFile()
 
 SysFsFile::~SysFsFile()
 {
-	if (m_fp)
+	if (m_fp && m_writeBehind)
+	{
+		getWriteBehindQueue()->submit(m_fp, m_path, std::move(m_buffer));
+	}
+	else if (m_fp)
 	{
 		::fclose(m_fp);
 	}
@@ -38,25 +49,56 @@ SysFsFile::~SysFsFile()
 
 uint64_t SysFsFile::write(const void *buffer, uint64_t elementSize, uint64_t elementCount)
 {
+	if (m_writeBehind)
+	{
+		const u8 *const data = static_cast<const u8 *>(buffer);
+		const size_t bytes = static_cast<size_t>(elementSize * elementCount);
+		if (m_position > m_buffer.size())
+		{
+			m_buffer.resize(static_cast<size_t>(m_position)); // seeked past the end
+		}
+		const size_t overwritten = std::min(bytes, m_buffer.size() - static_cast<size_t>(m_position));
+		memcpy(m_buffer.data() + m_position, data, overwritten);
+		m_buffer.insert(m_buffer.end(), data + overwritten, data + bytes);
+		m_position += bytes;
+		return elementCount;
+	}
 	return ::fwrite(buffer, static_cast<size_t>(elementSize), static_cast<size_t>(elementCount), m_fp);
 }
 
 uint64_t SysFsFile::read(void *buffer, uint64_t elementSize, uint64_t elementCount)
 {
+	if (m_writeBehind)
+	{
+		return 0;
+	}
 	return ::fread(buffer, static_cast<size_t>(elementSize), static_cast<size_t>(elementCount), m_fp);
 }
 
 uint64_t SysFsFile::size()
 {
-	uint64_t current = tell();
-	seek(0, SeekEnd);
-	uint64_t result = tell();
-	seek(current, SeekSet);
-	return result;
+	if (m_writeBehind)
+	{
+		return m_buffer.size();
+	}
+	// data buffered by stdio is never behind the current position, so it can only extend the file up to it
+#ifdef _WIN32
+	const uint64_t sizeOnDisk = static_cast<uint64_t>(::_filelengthi64(::_fileno(m_fp)));
+#else
+	struct stat st;
+	const uint64_t sizeOnDisk = ::fstat(::fileno(m_fp), &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+#endif
+	return std::max(sizeOnDisk, tell());
 }
 
 bool SysFsFile::seek(uint64_t offset, Attrib attr)
 {
+	if (m_writeBehind)
+	{
+		const uint64_t base = attr == SeekSet ? 0 : attr == SeekCur ? m_position : m_buffer.size();
+		m_position = base + offset; // negative offsets wrap around like they do for fseek
+		return true;
+	}
 #ifdef _WIN32
 	return ::_fseeki64(m_fp, static_cast<long long>(offset), static_cast<int>(attr)) == 0;
 #else
@@ -66,11 +108,20 @@ bool SysFsFile::seek(uint64_t offset, Attrib attr)
 
 void SysFsFile::rewind()
 {
+	if (m_writeBehind)
+	{
+		m_position = 0;
+		return;
+	}
 	::rewind(m_fp);
 }
 
 uint64_t SysFsFile::tell() const
 {
+	if (m_writeBehind)
+	{
+		return m_position;
+	}
 #ifdef _WIN32
 	return static_cast<uint64_t>(::_ftelli64(m_fp));
 #else
@@ -80,6 +131,10 @@ uint64_t SysFsFile::tell() const
 
 void SysFsFile::flush()
 {
+	if (m_writeBehind)
+	{
+		return; // whole file is written once it is closed
+	}
 	::fflush(m_fp);
 }
 
@@ -87,4 +142,96 @@ void SysFsFile::mstat( MetaStat *result )
 {
 }
 
+bool SysFsFile::readAt(void *buffer, uint64_t offset, uint64_t size)
+{
+	// Goes straight to the OS, so it does not see data buffered by write() and it does not touch stdio buffer.
+	if (m_writeBehind)
+	{
+		return false;
+	}
+	u8 *out = static_cast<u8 *>(buffer);
+#ifdef _WIN32
+	const HANDLE handle = reinterpret_cast<HANDLE>(::_get_osfhandle(::_fileno(m_fp)));
+	while (size > 0)
+	{
+		OVERLAPPED overlapped = {};
+		overlapped.Offset = static_cast<DWORD>(offset);
+		overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+		DWORD bytesRead = 0;
+		const DWORD bytesToRead = static_cast<DWORD>(std::min<uint64_t>(size, 0x40000000));
+		if (!::ReadFile(handle, out, bytesToRead, &bytesRead, &overlapped) || bytesRead == 0)
+		{
+			return false;
+		}
+		out += bytesRead;
+		offset += bytesRead;
+		size -= bytesRead;
+	}
+#else
+	const int fd = ::fileno(m_fp);
+	while (size > 0)
+	{
+		const ssize_t bytesRead = ::pread(fd, out, static_cast<size_t>(std::min<uint64_t>(size, 0x40000000)), static_cast<off_t>(offset));
+		if (bytesRead < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (bytesRead <= 0)
+		{
+			return false;
+		}
+		out += bytesRead;
+		offset += static_cast<uint64_t>(bytesRead);
+		size -= static_cast<uint64_t>(bytesRead);
+	}
+#endif
+	return true;
+}
+
+bool SysFsFile::copyRangeTo(File *output, uint64_t offset, uint64_t size)
+{
+#ifdef _WIN32
+	return false;
+#else
+	SysFsFile *const target = dynamic_cast<SysFsFile *>(output);
+	if (!target || m_writeBehind || (target->m_writeBehind && !target->m_buffer.empty()))
+	{
+		return false;
+	}
+	target->m_writeBehind = false; // nothing was formatted yet, so the file is written directly
+	::fflush(target->m_fp);
+
+	const int in = ::fileno(m_fp);
+	const int out = ::fileno(target->m_fp);
+	const off_t start = ::lseek(out, 0, SEEK_CUR);
+	off_t inputOffset = static_cast<off_t>(offset);
+	bool useSendfile = false; // copy_file_range is not supported between these files
+	for (uint64_t left = size; left > 0;)
+	{
+		const size_t chunk = static_cast<size_t>(std::min<uint64_t>(left, 0x40000000));
+		const ssize_t copied = useSendfile ? ::sendfile(out, in, &inputOffset, chunk) : ::copy_file_range(in, &inputOffset, out, nullptr, chunk, 0);
+		if (copied < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (copied < 0 && !useSendfile && left == size && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP))
+		{
+			useSendfile = true;
+			continue;
+		}
+		if (copied <= 0)
+		{
+			// partial copy is dropped, so the caller can copy the range again
+			if (::ftruncate(out, start) != 0 || ::lseek(out, start, SEEK_SET) != start)
+			{
+				error_f("system", target->m_path, "Unable to drop partially copied data! (%s)", strerror(errno));
+			}
+			return false;
+		}
+		left -= static_cast<uint64_t>(copied);
+	}
+	return ::fseeko(target->m_fp, start + static_cast<off_t>(size), SEEK_SET) == 0;
+#endif
+}
+
 /* eof */
@@ -43,10 +43,19 @@ public:
 	virtual uint64_t tell() const override;
 	virtual void flush() override;
 	virtual void mstat( MetaStat *result ) override;
+	virtual bool readAt(void *buffer, uint64_t offset, uint64_t size) override;
+	virtual bool copyRangeTo(File *output, uint64_t offset, uint64_t size) override;
 
 private:
 	FILE *m_fp = nullptr;
 
+	String m_path;
+
+	// write only files are formatted in memory and written by WriteBehindQueue when closed
+	bool m_writeBehind = false;
+	Array<u8> m_buffer;
+	uint64_t m_position = 0;
+
 	friend class SysFileSystem;
 };
 
@@ -26,6 +26,10 @@
 
 #include "file.h"
 
+#include <config.h>
+
+#include <unordered_set>
+
 UberFileSystem::UberFileSystem()
 {
 }
@@ -46,17 +50,37 @@ String UberFileSystem::name() const
 
 UniquePtr<File> UberFileSystem::open(const String &filename, FsOpenMode mode, bool *outFileExists)
 {
-	for (auto it = m_filesystems.rbegin(); it != m_filesystems.rend(); ++it)
+	const bool cacheable = Config::s_fileCacheSize > 0 && !(mode & (write | append | update));
+	const u64 hash = hashPath(filename);
+
+	UniquePtr<File> result;
+	probe(filename, hash, [&](FileSystem *fs)
 	{
+		if (cacheable && fs->isReadOnly())
+		{
+			if (UniquePtr<File> cached = m_cache.open(fs, hash, filename))
+			{
+				if( outFileExists ) *outFileExists = true;
+				result = std::move(cached);
+				return true;
+			}
+		}
+
 		bool fileExists = false;
-		UniquePtr<File> file = (*it).second->open( filename, mode, &fileExists );
+		UniquePtr<File> file = fs->open( filename, mode, &fileExists );
 		if ( fileExists )
 		{
 			if( outFileExists ) *outFileExists = true;
-			return file;
+			if (file && cacheable && fs->isReadOnly())
+			{
+				file = m_cache.wrap(fs, hash, std::move(file));
+			}
+			result = std::move(file);
+			return true;
 		}
-	}
-	return UniquePtr<File>();
+		return false;
+	});
+	return result;
 }
 
 bool UberFileSystem::remove( const String &filePath )
@@ -76,87 +100,117 @@ bool UberFileSystem::rmdir(const String &directory)
 
 bool UberFileSystem::exists(const String &filename)
 {
-	for (const auto &fs : m_filesystems)
+	return probe(filename, hashPath(filename), [&](FileSystem *fs)
 	{
-		if (fs.second->exists(filename))
-			return true;
-	}
-	return false;
+		return fs->exists(filename);
+	});
 }
 
 bool UberFileSystem::dirExists(const String &dirpath)
 {
-	for (const auto &fs : m_filesystems)
+	return probe(dirpath, hashPath(dirpath), [&](FileSystem *fs)
 	{
-		if (fs.second->dirExists(dirpath))
-			return true;
-	}
-	return false;
+		return fs->dirExists(dirpath);
+	});
 }
 
-auto UberFileSystem::readDir(const String &path, bool absolutePaths, bool recursive) -> UniquePtr<List<Entry>>
+bool UberFileSystem::visitDir(const String &path, bool absolutePaths, bool recursive, const DirVisitor &visitor)
 {
-	UniquePtr<List<Entry>> result;
-	Map<String, int> aux;
-
+	Array<FileSystem *> filesystems;
 	for (auto it = m_filesystems.rbegin(); it != m_filesystems.rend(); ++it)
 	{
-		const auto &fs = (*it);
-		if(!fs.second->dirExists(path))
+		if ((*it).second->dirExists(path))
 		{
-			continue;
+			filesystems.push_back((*it).second);
 		}
+	}
 
-		auto current = fs.second->readDir(path, absolutePaths, recursive);
-		if (!current)
-		{
-			continue;
-		}
+	if (filesystems.size() == 1)
+	{
+		return filesystems[0]->visitDir(path, absolutePaths, recursive, visitor);
+	}
 
-		if (!result)
+	// listings of this directory are merged, entries of the same name from lower priority filesystems are skipped;
+	// subdirectories are merged the same way afterwards, so only one directory per level of recursion is kept at a time
+	const String prefix = removeSlashAtEnd(path) + "/";
+	std::unordered_set<u64> visited;
+	Array<String> subdirectories;
+	bool read = false;
+	for (FileSystem *const fs : filesystems)
+	{
+		read |= fs->visitDir(path, absolutePaths, false, [&](const Entry &entry)
 		{
-			result = std::make_unique<List<Entry>>();
-		}
+			if (!visited.insert(prism::city_hash_64(entry.GetPath().c_str(), entry.GetPath().length())).second)
+			{
+				return;
+			}
+			visitor(entry);
+			if (recursive && entry.IsDirectory())
+			{
+				subdirectories.push_back(absolutePaths ? entry.GetPath() : prefix + entry.GetPath());
+			}
+		});
+	}
 
-		for (const FileSystem::Entry &entry : (*current))
-		{
-			int &auxValue = aux[entry.GetPath()];
-			if (auxValue == 1) { continue; }
-			auxValue = 1;
-			result->push_back(entry);
-		}
+	std::unordered_set<u64>().swap(visited);
+	for (const String &subdirectory : subdirectories)
+	{
+		visitDir(subdirectory, absolutePaths, recursive, visitor);
 	}
-	return result;
+	return read;
 }
 
-bool UberFileSystem::mstat( MetaStat *result, const String &path )
+bool UberFileSystem::pin(const String &filename)
 {
-	for( auto it = m_filesystems.rbegin(); it != m_filesystems.rend(); ++it )
+	const u64 hash = hashPath(filename);
+	FileSystem *const fs = cachingFileSystem(filename, hash);
+	if (!fs)
 	{
-		if( ( *it ).second->mstat( result, path ) )
-		{
-			return true;
-		}
+		return false;
 	}
-	return false;
+	m_cache.pin(fs, hash);
+	return true;
+}
+
+void UberFileSystem::unpin(const String &filename)
+{
+	const u64 hash = hashPath(filename);
+	if (FileSystem *const fs = cachingFileSystem(filename, hash))
+	{
+		m_cache.unpin(fs, hash);
+	}
+}
+
+bool UberFileSystem::mstat( MetaStat *result, const String &path )
+{
+	return probe( path, hashPath( path ), [ & ]( FileSystem *fs )
+	{
+		return fs->mstat( result, path );
+	} );
 }
 
 FileSystem *UberFileSystem::mount(UniquePtr<FileSystem> fs, Priority priority)
 {
 	m_ownedFileSystems.push_back( std::move( fs ) );
-	FileSystem *const fsPtr = m_ownedFileSystems.back().get();
-	m_filesystems[ priority ] = fsPtr;
-	return fsPtr;
+	return mount( m_ownedFileSystems.back().get(), priority );
 }
 
 FileSystem *UberFileSystem::mount( FileSystem *fs, Priority priority )
 {
+	auto replaced = m_filesystems.find( priority );
+	if( replaced != m_filesystems.end() )
+	{
+		unindexFileSystem( replaced->second );
+	}
 	m_filesystems[ priority ] = fs;
+	indexFileSystem( fs, priority );
 	return fs;
 }
 
 void UberFileSystem::unmount(FileSystem *filesystem)
 {
+	m_cache.erase(filesystem);
+	unindexFileSystem(filesystem);
 	for( const auto &fs : m_filesystems )
 	{
         if( fs.second == filesystem )
@@ -171,4 +225,160 @@ void UberFileSystem::unmount(FileSystem *filesystem)
 	} ), m_ownedFileSystems.end() );
 }
 
+u64 UberFileSystem::hashPath(const String &path)
+{
+	if (path.empty())
+	{
+		return prism::city_hash_64("", 0);
+	}
+	// archives index directories without trailing slash
+	const size_t length = path.length() > 1 && path.back() == '/' ? path.length() - 1 : path.length();
+	return prism::city_hash_64(path.c_str() + 1, length - 1);
+}
+
+FileSystem *UberFileSystem::cachingFileSystem(const String &filename, u64 hash) const
+{
+	FileSystem *result = nullptr;
+	probe(filename, hash, [&](FileSystem *fs)
+	{
+		if (!fs->exists(filename))
+		{
+			return false;
+		}
+		result = fs->isReadOnly() ? fs : nullptr;
+		return true;
+	});
+	return result;
+}
+
+bool UberFileSystem::probe(const String &path, u64 hash, const std::function<bool(FileSystem *fs)> &probe) const
+{
+	if (m_filesystems.size() == 1)
+	{
+		// nothing to choose from, the index would only add a lookup
+		return probe(m_filesystems.begin()->second);
+	}
+
+	const u32 slot = m_index.find(hash);
+	if (slot == HashIndex::NOT_FOUND)
+	{
+		for (auto it = m_unindexedFileSystems.rbegin(); it != m_unindexedFileSystems.rend(); ++it)
+		{
+			if (probe(it->second))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	const Priority ownerPriority = m_indexedFileSystems[slot].first;
+	for (auto it = m_unindexedFileSystems.rbegin(); it != m_unindexedFileSystems.rend() && it->first > ownerPriority; ++it)
+	{
+		if (probe(it->second))
+		{
+			return true;
+		}
+	}
+	if (probe(m_indexedFileSystems[slot].second))
+	{
+		return true;
+	}
+
+	// owner has such entry but did not accept it (e.g. it is directory, not file), ask the rest as usual
+	for (auto it = std::make_reverse_iterator(m_filesystems.find(ownerPriority)); it != m_filesystems.rend(); ++it)
+	{
+		if (probe(it->second))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void UberFileSystem::indexFileSystem(FileSystem *fs, Priority priority)
+{
+	u32 slot = indexedSlot(nullptr);
+	if (slot == HashIndex::NOT_FOUND)
+	{
+		slot = static_cast<u32>(m_indexedFileSystems.size());
+		m_indexedFileSystems.emplace_back();
+	}
+
+	const bool indexed = fs->visitEntryHashes([&](u64 hash)
+	{
+		const u32 owner = m_index.find(hash);
+		if (owner == HashIndex::NOT_FOUND || m_indexedFileSystems[owner].first < priority)
+		{
+			m_index.insert(hash, slot);
+		}
+	});
+	if (indexed)
+	{
+		m_indexedFileSystems[slot] = Pair<Priority, FileSystem *>(priority, fs);
+	}
+	else
+	{
+		m_unindexedFileSystems[priority] = fs;
+	}
+}
+
+void UberFileSystem::unindexFileSystem(FileSystem *fs)
+{
+	for (auto it = m_unindexedFileSystems.begin(); it != m_unindexedFileSystems.end(); ++it)
+	{
+		if (it->second == fs)
+		{
+			m_unindexedFileSystems.erase(it);
+			return;
+		}
+	}
+
+	const u32 slot = indexedSlot(fs);
+	if (slot == HashIndex::NOT_FOUND)
+	{
+		return;
+	}
+
+	// hashes owned by the filesystem pass to the next indexed filesystem containing them
+	std::unordered_set<u64> released;
+	fs->visitEntryHashes([&](u64 hash)
+	{
+		if (m_index.find(hash) == slot)
+		{
+			m_index.erase(hash);
+			released.insert(hash);
+		}
+	});
+	m_indexedFileSystems[slot] = Pair<Priority, FileSystem *>();
+
+	for (auto it = m_filesystems.rbegin(); it != m_filesystems.rend() && !released.empty(); ++it)
+	{
+		const u32 candidate = indexedSlot(it->second);
+		if (candidate == HashIndex::NOT_FOUND)
+		{
+			continue;
+		}
+		it->second->visitEntryHashes([&](u64 hash)
+		{
+			if (released.erase(hash) > 0)
+			{
+				m_index.insert(hash, candidate);
+			}
+		});
+	}
+}
+
+u32 UberFileSystem::indexedSlot(const FileSystem *fs) const
+{
+	for (size_t i = 0; i < m_indexedFileSystems.size(); ++i)
+	{
+		if (m_indexedFileSystems[i].second == fs)
+		{
+			return static_cast<u32>(i);
+		}
+	}
+	return HashIndex::NOT_FOUND;
+}
+
 /* eof */
@@ -23,6 +23,8 @@
 #pragma once
 
 #include "filesystem.h"
+#include "file_cache.h"
+#include "hash_index.h"
 
 class UberFileSystem : public FileSystem
 {
@@ -41,16 +43,48 @@ public:
 	virtual bool rmdir(const String &directory) override;
 	virtual bool exists(const String &filename) override;
 	virtual bool dirExists(const String &dirpath) override;
-	virtual UniquePtr<List<Entry>> readDir(const String &path, bool absolutePaths, bool recursive) override;
+	virtual bool visitDir(const String &path, bool absolutePaths, bool recursive, const DirVisitor &visitor) override;
 	virtual bool mstat( MetaStat *result, const String &path ) override;
 
 	FileSystem *mount(UniquePtr<FileSystem> fs, Priority priority);
 	FileSystem *mount(FileSystem *fs, Priority priority);
 	void unmount(FileSystem *fs);
 
+	/**
+	 * @brief Keeps cached contents of the file from being evicted until unpinned
+	 * @return False when contents of the file are not cached (it is missing or its filesystem is writable)
+	 */
+	bool pin(const String &filename);
+	void unpin(const String &filename);
+
+	FileCache::Statistics cacheStatistics() const { return m_cache.statistics(); }
+
+private:
+	static u64 hashPath(const String &path);
+
+	/**
+	 * Calls probe for filesystems which may contain the path, in priority order, until it returns true.
+	 * Indexed filesystems are skipped unless they own the path hash in the merged index.
+	 */
+	bool probe(const String &path, u64 hash, const std::function<bool(FileSystem *fs)> &probe) const;
+
+	/**
+	 * Returns filesystem which serves the file when its contents are cached (it is read-only), nullptr otherwise.
+	 */
+	FileSystem *cachingFileSystem(const String &filename, u64 hash) const;
+
+	void indexFileSystem(FileSystem *fs, Priority priority);
+	void unindexFileSystem(FileSystem *fs);
+	u32 indexedSlot(const FileSystem *fs) const;
+
 private:
 	std::map<Priority, FileSystem*> m_filesystems;
 	Array<UniquePtr<FileSystem>> m_ownedFileSystems;
+	FileCache m_cache; // decompressed entries of read-only filesystems
+
+	HashIndex m_index; // path hash -> slot of the highest priority indexed filesystem containing it
+	Array<Pair<Priority, FileSystem *>> m_indexedFileSystems; // slots, null filesystem marks free slot
+	std::map<Priority, FileSystem *> m_unindexedFileSystems; // filesystems which cannot enumerate their entries
 };
 
 /* eof */
@@ -0,0 +1,164 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/write_behind.cpp
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+#include <prerequisites.h>
+
+#include "write_behind.h"
+
+#include "config.h"
+
+WriteBehindQueue::WriteBehindQueue()
+{
+	char workingDirectory[4096];
+#ifdef _WIN32
+	if (_getcwd(workingDirectory, sizeof(workingDirectory)))
+#else
+	if (getcwd(workingDirectory, sizeof(workingDirectory)))
+#endif
+	{
+		m_workingDirectory = workingDirectory;
+	}
+	m_writer = std::thread(&WriteBehindQueue::writerMain, this);
+}
+
+WriteBehindQueue::~WriteBehindQueue()
+{
+	drain();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_queued.notify_all();
+	m_writer.join();
+}
+
+void WriteBehindQueue::submit(FILE *fp, const String &path, Array<u8> data)
+{
+	String key = normalizePath(path);
+	std::unique_lock<std::mutex> lock(m_mutex);
+	const u64 size = data.size();
+	// single file bigger than the budget is let through once everything before it is written
+	m_written.wait(lock, [&]
+	{
+		return m_pending.size() < MAX_PENDING_FILES && (m_bytes == 0 || m_bytes + size <= Config::s_writeBehindSize);
+	});
+	m_bytes += size;
+	m_pendingPaths.insert(key);
+	m_pending.push_back({ fp, path, std::move(key), std::move(data) });
+	lock.unlock();
+	m_queued.notify_one();
+}
+
+void WriteBehindQueue::wait(const String &path)
+{
+	const String key = normalizePath(path);
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_written.wait(lock, [&] { return m_pendingPaths.find(key) == m_pendingPaths.end(); });
+}
+
+bool WriteBehindQueue::drain()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_written.wait(lock, [&] { return m_pendingPaths.empty(); });
+	const bool failed = m_failed;
+	m_failed = false;
+	return !failed;
+}
+
+void WriteBehindQueue::writerMain()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;)
+	{
+		m_queued.wait(lock, [&] { return m_stop || !m_pending.empty(); });
+		if (m_pending.empty())
+		{
+			return;
+		}
+
+		Pending pending = std::move(m_pending.front());
+		m_pending.pop_front();
+		lock.unlock();
+
+		bool written = pending.m_data.empty() || ::fwrite(pending.m_data.data(), 1, pending.m_data.size(), pending.m_fp) == pending.m_data.size();
+		written &= ::fclose(pending.m_fp) == 0;
+		if (!written)
+		{
+			error_f("system", pending.m_path, "Unable to write file! (%s)", strerror(errno));
+		}
+		const u64 size = pending.m_data.size();
+		Array<u8>().swap(pending.m_data);
+
+		lock.lock();
+		m_failed |= !written;
+		m_bytes -= size;
+		m_pendingPaths.erase(m_pendingPaths.find(pending.m_key));
+		m_written.notify_all();
+	}
+}
+
+String WriteBehindQueue::normalizePath(const String &path) const
+{
+	// lexical only, so different spellings of one path share the key: separators, "." and ".." segments, relative paths
+	const bool isAbsolute = (!path.empty() && (path[0] == '/' || path[0] == '\\')) || (path.length() > 1 && path[1] == ':');
+	String absolute = isAbsolute ? path : m_workingDirectory + "/" + path;
+	std::replace(absolute.begin(), absolute.end(), '\\', '/');
+
+	const size_t rootLength = absolute[0] == '/' ? 1 : absolute.find('/') == String::npos ? absolute.length() : absolute.find('/') + 1;
+	String result = absolute.substr(0, rootLength);
+	Array<size_t> segments; // offsets in result where segments start
+	for (size_t begin = rootLength; begin < absolute.length();)
+	{
+		size_t end = absolute.find('/', begin);
+		if (end == String::npos)
+		{
+			end = absolute.length();
+		}
+		const size_t length = end - begin;
+		if (length == 2 && absolute.compare(begin, 2, "..") == 0)
+		{
+			if (!segments.empty())
+			{
+				result.resize(segments.back());
+				segments.pop_back();
+			}
+		}
+		else if (length > 0 && !(length == 1 && absolute[begin] == '.'))
+		{
+			segments.push_back(result.length());
+			if (result.length() > rootLength)
+			{
+				result += '/';
+			}
+			result.append(absolute, begin, length);
+		}
+		begin = end + 1;
+	}
+	return result;
+}
+
+WriteBehindQueue *getWriteBehindQueue()
+{
+	static WriteBehindQueue queue;
+	return &queue;
+}
+
+/* eof */
@@ -0,0 +1,87 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/fs/write_behind.h
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+#pragma once
+
+#include <unordered_set>
+
+/**
+ * @brief Writes output files to disk on a dedicated thread
+ *
+ * Files opened by SysFileSystem for writing only are formatted into memory and handed over
+ * here when they are closed, so conversion threads do not wait for the disk. Files waiting
+ * to be written are limited by Config::s_writeBehindSize and by MAX_PENDING_FILES, as each of
+ * them holds its descriptor open, submitting blocks when either is exceeded.
+ */
+class WriteBehindQueue
+{
+public:
+	static constexpr size_t MAX_PENDING_FILES = 256;
+
+public:
+	WriteBehindQueue();
+	~WriteBehindQueue();
+	WriteBehindQueue(const WriteBehindQueue &) = delete;
+	WriteBehindQueue &operator=(const WriteBehindQueue &) = delete;
+
+	/**
+	 * @brief Queues contents of the file to be written and closed, takes ownership of fp
+	 */
+	void submit(FILE *fp, const String &path, Array<u8> data);
+
+	/**
+	 * @brief Blocks until given file is written, does nothing when it is not queued
+	 */
+	void wait(const String &path);
+
+	/**
+	 * @brief Blocks until every queued file is written, false when any write failed since the last drain
+	 */
+	bool drain();
+
+private:
+	struct Pending
+	{
+		FILE *m_fp;
+		String m_path;
+		String m_key; // normalized path
+		Array<u8> m_data;
+	};
+
+	void writerMain();
+	String normalizePath(const String &path) const;
+
+private:
+	std::mutex m_mutex;
+	std::condition_variable m_queued; // wakes the writer
+	std::condition_variable m_written; // wakes submitters and waiters
+	List<Pending> m_pending; // written in order of submission
+	std::unordered_multiset<String> m_pendingPaths; // normalized, includes the file being written
+	String m_workingDirectory; // relative paths are resolved against it
+	u64 m_bytes = 0; // queued and being written
+	bool m_failed = false;
+	bool m_stop = false;
+	std::thread m_writer;
+};
+
+WriteBehindQueue *getWriteBehindQueue();
+
+/* eof */
@@ -27,6 +27,7 @@
 #include "sysfilesystem.h"
 #include "file.h"
 #include "zipfs_file.h"
+#include "mount_index.h"
 
 #include <structs/zip.h>
 
@@ -39,7 +40,7 @@
 ZipFileSystem::ZipFileSystem(const String &root)
 {
 	m_rootFilename = root;
-	m_root = getSFS()->open(root, FileSystem::read | FileSystem::binary);
+	m_root = openArchiveRoot(root);
 	if (!m_root)
 	{
 		error("zipfs", root, "Unable to open root file");
@@ -132,12 +133,12 @@ bool ZipFileSystem::dirExists(const String &dirpath)
 	return true;
 }
 
-auto ZipFileSystem::readDir(const String &path, bool absolutePaths, bool recursive) -> UniquePtr<List<Entry>>
+bool ZipFileSystem::visitDir(const String &path, bool absolutePaths, bool recursive, const DirVisitor &visitor)
 {
 	if (path.empty())
 	{
-		error("zipfs", m_rootFilename, "readDir: Path is empty!");
-		return UniquePtr<List<Entry>>();
+		error("zipfs", m_rootFilename, "visitDir: Path is empty!");
+		return false;
 	}
 
 	String dirpath = path.size() != 1 ? removeSlashAtEnd(path) : path;
@@ -146,56 +147,38 @@ auto ZipFileSystem::readDir(const String &path, bool absolutePaths, bool recursi
 	if (!entry)
 	{
 		error_f("zipfs", m_rootFilename, "Failed to find entry (%s)", path);
-		return UniquePtr<List<Entry>>();
+		return false;
 	}
 
 	if (!entry->m_directory)
 	{
 		error_f("zipfs", m_rootFilename, "Entry is not directory");
-		return UniquePtr<List<Entry>>();
+		return false;
 	}
 
-	auto result = std::make_unique<List<Entry>>();
+	visitChildren(*entry, absolutePaths ? removeSlashAtEnd(dirpath) + "/" : String(), absolutePaths, recursive, visitor);
+	return true;
+}
 
-	for (const ZipEntry *const e : entry->m_children)
+void ZipFileSystem::visitChildren(const ZipEntry &directory, const String &prefix, bool absolutePaths, bool recursive, const DirVisitor &visitor)
+{
+	for (u32 child = directory.m_firstChild; child != ZipEntry::NONE; child = m_entries[child].m_nextSibling)
 	{
-		if (e->m_directory)
-		{
-			String directorypath;
-			if (absolutePaths)
-			{
-				directorypath = removeSlashAtEnd(dirpath) + "/" + e->m_name;
-			}
-			else
-			{
-				directorypath = e->m_name;
-			}
-			result->push_back(Entry(directorypath, true, false, this));
-			if (recursive)
-			{
-				auto subdir = readDir(directorypath, absolutePaths, recursive);
-				if (subdir)
-				{
-					result->insert(result->end(), subdir->begin(), subdir->end());
-				}
-			}
-		}
-		else
+		const ZipEntry &e = m_entries[child];
+		const StringView name = m_paths.name(e.m_path);
+
+		String entrypath;
+		entrypath.reserve(prefix.length() + name.length());
+		entrypath.append(prefix).append(name);
+
+		const Entry visited(std::move(entrypath), e.m_directory, false, this);
+		visitor(visited);
+		if (e.m_directory && recursive)
 		{
-			String filepath;
-			if (absolutePaths)
-			{
-				filepath = removeSlashAtEnd(dirpath) + "/" + e->m_name;
-			}
-			else
-			{
-				filepath = e->m_name;
-			}
-			result->push_back(Entry(filepath, false, false, this));
+			// relative names are relative to each visited directory, as in other filesystems
+			visitChildren(e, absolutePaths ? visited.GetPath() + "/" : String(), absolutePaths, recursive, visitor);
 		}
 	}
-
-	return result;
 }
 
 bool ZipFileSystem::mstat( MetaStat *result, const String &path )
@@ -209,18 +192,69 @@ bool ZipFileSystem::mstat( MetaStat *result, const String &path )
 	else return false;
 }
 
+bool ZipFileSystem::visitEntryHashes(const std::function<void(u64 hash)> &visitor) const
+{
+	for (const ZipEntry &entry : m_entries)
+	{
+		visitor(entry.m_hash);
+	}
+	return true;
+}
+
+u64 ZipFileSystem::archiveOffset(const String &path)
+{
+	ZipEntry *const entry = findEntry(path);
+	return entry ? entry->m_offset : UINT64_MAX;
+}
+
 bool ZipFileSystem::ioRead(void *const buffer, uint64_t bytes, uint64_t offset)
 {
-	return m_root->blockRead(buffer, offset, bytes);
+	countArchiveRead(bytes);
+	return m_root->readAt(buffer, offset, bytes);
+}
+
+const void *ZipFileSystem::ioMap(uint64_t bytes, uint64_t offset) const
+{
+	const void *const mapped = m_root->map(offset, bytes);
+	if (mapped)
+	{
+		countArchiveRead(bytes);
+	}
+	return mapped;
+}
+
+bool ZipFileSystem::ioCopy(File *output, uint64_t bytes, uint64_t offset)
+{
+	if (!m_root->copyRangeTo(output, offset, bytes))
+	{
+		return false;
+	}
+	countArchiveRead(bytes);
+	return true;
+}
+
+namespace
+{
+	// sections: entries, nodes and names of path pool
+	constexpr u32 MOUNT_INDEX_FORMAT = MAKEFOURCC('Z', 'I', 'P', '2');
 }
 
 void ZipFileSystem::readZip()
 {
+	if (readMountIndex())
+	{
+		return;
+	}
+
+	m_entries.clear();
+	m_paths.clear();
+
 	ZipEntry rootEntry;
 	rootEntry.m_directory = true;
-	rootEntry.m_name = "";
-	rootEntry.m_path = "/";
-	registerEntry(rootEntry);
+	rootEntry.m_hash = prism::city_hash_64("", 0);
+	rootEntry.m_path = PathPool::ROOT;
+	m_entries.push_back(rootEntry);
+	m_entryIndex.insert(rootEntry.m_hash, 0);
 
 	const uint64_t size = m_root->size();
 	if (size <= sizeof(zip::EndOfCentralDirectory))
@@ -231,7 +265,7 @@ void ZipFileSystem::readZip()
 
 	uint64_t blockSizeToFindCentralDirEnd = ((size < 0x4000) ? size : 0x4000);
 	UniquePtr<uint8_t[]> blockToFindCentralDirEnd(new uint8_t[static_cast<size_t>(blockSizeToFindCentralDirEnd)]);
-	if (!m_root->blockRead(blockToFindCentralDirEnd.get(), size - blockSizeToFindCentralDirEnd, blockSizeToFindCentralDirEnd))
+	if (!m_root->readAt(blockToFindCentralDirEnd.get(), size - blockSizeToFindCentralDirEnd, blockSizeToFindCentralDirEnd))
 	{
 		error("zipfs", m_rootFilename, "Failed to read the zip::EndOfCentralDirectory structure!");
 		return;
@@ -267,10 +301,14 @@ void ZipFileSystem::readZip()
 		return;
 	}
 
+	m_entries.reserve(centralDirEnd->numEntries + 1);
+	m_paths.reserve(centralDirEnd->numEntries + 1, centralDirEnd->numEntries * 16);
+	m_entryIndex.reserve(centralDirEnd->numEntries + 1);
+
 	for (size_t e = 0, currentOffset = centralDirEnd->offset; e < centralDirEnd->numEntries; ++e)
 	{
 		zip::CentralDirectoryFileHeader entry;
-		if (!m_root->blockRead(&entry, currentOffset, sizeof(zip::CentralDirectoryFileHeader)))
+		if (!m_root->readAt(&entry, currentOffset, sizeof(zip::CentralDirectoryFileHeader)))
 		{
 			error_f("zipfs", m_rootFilename, "Failed to read central directory data(%u)!", e);
 			return;
@@ -289,20 +327,28 @@ void ZipFileSystem::readZip()
 		}
 
 		char filenameBuffer[256] = { 0 };
-		if (!m_root->blockRead(filenameBuffer, currentOffset + sizeof(zip::CentralDirectoryFileHeader), entry.filenameLength))
+		if (!m_root->readAt(filenameBuffer, currentOffset + sizeof(zip::CentralDirectoryFileHeader), entry.filenameLength))
 		{
 			error_f("zipfs", m_rootFilename, "Failed to read name of directory data(%u)!", e);
 			return;
 		}
-		const String filename = filenameBuffer;
+		StringView filename(filenameBuffer);
 
 		if (entry.compressionMethod != zip::COMPRESSION_METHOD::STORED && entry.compressionMethod != zip::COMPRESSION_METHOD::DEFLATED)
 		{
-			error_f("zipfs", m_rootFilename, "Unsupported compression method(%s : %u)!", filename.c_str(), entry.compressionMethod);
+			error_f("zipfs", m_rootFilename, "Unsupported compression method(%s : %u)!", filenameBuffer, entry.compressionMethod);
 			return;
 		}
 
-		processEntry(trimSlashesAtEnd(trimSlashesAtBegin(filename)), &entry);
+		while (!filename.empty() && (filename.front() == '/' || filename.front() == '\\'))
+		{
+			filename.remove_prefix(1);
+		}
+		while (!filename.empty() && (filename.back() == '/' || filename.back() == '\\'))
+		{
+			filename.remove_suffix(1);
+		}
+		processEntry(filename, &entry);
 
 		currentOffset += sizeof(zip::CentralDirectoryFileHeader)
 			+ entry.filenameLength
@@ -310,10 +356,91 @@ void ZipFileSystem::readZip()
 			+ entry.fileCommentLength;
 	}
 
-	link();
+	m_entries.shrink_to_fit();
+	m_paths.shrinkToFit();
+	sortChildren();
+	writeMountIndex();
 }
 
-void ZipFileSystem::processEntry(const String &name, zip::CentralDirectoryFileHeader *entry)
+bool ZipFileSystem::readMountIndex()
+{
+	MountIndex index;
+	if (!index.load(m_rootFilename, MOUNT_INDEX_FORMAT))
+	{
+		return false;
+	}
+
+	Array<ZipEntry> entries;
+	Array<PathPool::Node> nodes;
+	Array<char> names;
+	if (!index.section(0, entries) || !index.section(1, nodes) || !index.section(2, names) || entries.empty() || !m_paths.assign(std::move(nodes), std::move(names)))
+	{
+		warning("zipfs", m_rootFilename, "Mount index is corrupted, reading archive instead!");
+		m_paths.clear();
+		return false;
+	}
+
+	for (const ZipEntry &entry : entries)
+	{
+		if (entry.m_path >= m_paths.size()
+		 || (entry.m_firstChild != ZipEntry::NONE && entry.m_firstChild >= entries.size())
+		 || (entry.m_nextSibling != ZipEntry::NONE && entry.m_nextSibling >= entries.size()))
+		{
+			warning("zipfs", m_rootFilename, "Mount index is corrupted, reading archive instead!");
+			m_paths.clear();
+			return false;
+		}
+	}
+
+	// the tree has to be acyclic, otherwise walking it never ends: registerEntry links every entry
+	// once, the root never, and children are always stored after their directory
+	Array<bool> linked(entries.size(), false);
+	const auto link = [&linked](u32 index)
+	{
+		if (index == ZipEntry::NONE)
+		{
+			return true;
+		}
+		if (index == 0 || linked[index])
+		{
+			return false;
+		}
+		linked[index] = true;
+		return true;
+	};
+	bool acyclic = std::all_of(entries.begin(), entries.end(), [&link](const ZipEntry &entry)
+	{
+		return link(entry.m_firstChild) && link(entry.m_nextSibling);
+	});
+	for (u32 directory = 0; acyclic && directory < entries.size(); ++directory)
+	{
+		for (u32 child = entries[directory].m_firstChild; acyclic && child != ZipEntry::NONE; child = entries[child].m_nextSibling)
+		{
+			acyclic = child > directory;
+		}
+	}
+	if (!acyclic)
+	{
+		warning("zipfs", m_rootFilename, "Mount index is corrupted, reading archive instead!");
+		m_paths.clear();
+		return false;
+	}
+
+	m_entries = std::move(entries);
+	m_entryIndex.build(static_cast<u32>(m_entries.size()), [this](u32 index) { return m_entries[index].m_hash; });
+	return true;
+}
+
+void ZipFileSystem::writeMountIndex() const
+{
+	MountIndex index;
+	index.addSection(m_entries);
+	index.addSection(m_paths.nodes());
+	index.addSection(m_paths.names());
+	index.store(m_rootFilename, MOUNT_INDEX_FORMAT);
+}
+
+void ZipFileSystem::processEntry(StringView name, zip::CentralDirectoryFileHeader *entry)
 {
 	ZipEntry zipentry;
 
@@ -351,23 +478,10 @@ void ZipFileSystem::processEntry(const String &name, zip::CentralDirectoryFileHe
 		return;
 	}
 
-	if (zipentry.m_directory)
-	{
-		String dirname = trimSlashesAtEnd(trimSlashesAtBegin(name));
-		zipentry.m_name = dirname.substr(dirname.find_last_of('/') + 1);
-		zipentry.m_path = "/" + dirname;
-	}
-	else
-	{
-		String filename = trimSlashesAtEnd(trimSlashesAtBegin(name));
-		zipentry.m_name = filename.substr(filename.find_last_of('/') + 1);
-		zipentry.m_path = "/" + filename;
-	}
-
 	if (!zipentry.m_directory)
 	{
 		zip::LocalFileHeader localEntry;
-		if (!m_root->blockRead(&localEntry, zipentry.m_offset, sizeof(zip::LocalFileHeader)))
+		if (!m_root->readAt(&localEntry, zipentry.m_offset, sizeof(zip::LocalFileHeader)))
 		{
 			error_f("zipfs", m_rootFilename, "Failed to read local file header data!");
 			return;
@@ -393,127 +507,82 @@ void ZipFileSystem::processEntry(const String &name, zip::CentralDirectoryFileHe
 		zipentry.m_offset = 0;
 	}
 
-	registerEntry(zipentry);
+	registerEntry(name, zipentry);
 }
 
-ZipEntry *ZipFileSystem::registerEntry(const ZipEntry &entry)
+u32 ZipFileSystem::registerEntry(StringView path, const ZipEntry &entry)
 {
-	if (ZipEntry *existing = findEntry(entry.m_path))
+	// parent directories which are not listed in the archive are created on the way
+	u32 parent = 0;
+	for (size_t begin = 0;;)
 	{
-		return existing;
-	}
-	const uint64_t hash = prism::city_hash_64(entry.m_path.c_str() + 1, entry.m_path.length() - 1);
-	ZipEntry *const e = &(m_entries[hash] = entry);
-	return e;
-}
-
-void ZipFileSystem::link()
-{
-	Array<ZipEntry> toRegister;
+		const size_t slash = path.find('/', begin);
+		const StringView prefix = path.substr(0, slash);
+		const u64 hash = prism::city_hash_64(prefix.data(), prefix.length());
 
-	for (Pair<const u64, ZipEntry> &entry : m_entries)
-	{
-		ZipEntry *const e = &entry.second;
-		if (e->m_path != "/")
+		u32 index = m_entryIndex.find(hash);
+		if (index == HashIndex::NOT_FOUND)
 		{
-			String directory = trimSlashesAtEnd(trimSlashesAtBegin(e->m_path.substr(0, e->m_path.find_last_of('/'))));
-			ZipEntry *dir = findEntry("/" + directory);
-			if (!dir)
+			ZipEntry e;
+			if (slash == StringView::npos)
 			{
-				auto dirit = std::find_if(toRegister.begin(), toRegister.end(),
-					[directory](ZipEntry &e)
-					{
-						return e.path() == ("/" + directory);
-					});
-				if (dirit == toRegister.end())
-				{
-					ZipEntry newDirEntry;
-					newDirEntry.m_directory = true;
-					newDirEntry.m_name = directory.substr(directory.find_last_of('/') + 1);
-					newDirEntry.m_path = "/" + directory;
-					newDirEntry.m_compressed = false;
-					newDirEntry.m_size = 0;
-					newDirEntry.m_compressedSize = 0;
-					newDirEntry.m_offset = 0;
-					toRegister.push_back(newDirEntry);
-				}
+				e = entry;
 			}
-		}
-	}
-
-	for (size_t i = 0; i < toRegister.size(); ++i)
-	{
-		ZipEntry entry = toRegister[i];
-		if (entry.m_path != "/" && !entry.m_path.empty())
-		{
-			ZipEntry *const e = registerEntry(entry);
-			String directory = trimSlashesAtEnd(trimSlashesAtBegin(e->m_path.substr(0, e->m_path.find_last_of('/'))));
-			ZipEntry *dir = findEntry("/" + directory);
-			if (!dir)
+			else
 			{
-				ZipEntry newDirEntry;
-				newDirEntry.m_directory = true;
-				newDirEntry.m_name = directory.substr(directory.find_last_of('/') + 1);
-				newDirEntry.m_path = "/" + directory;
-				newDirEntry.m_compressed = false;
-				newDirEntry.m_size = 0;
-				newDirEntry.m_compressedSize = 0;
-				newDirEntry.m_offset = 0;
-				toRegister.push_back(newDirEntry);
+				e.m_directory = true;
 			}
+			e.m_hash = hash;
+			e.m_path = m_paths.add(m_entries[parent].m_path, path.substr(begin, slash == StringView::npos ? StringView::npos : slash - begin));
+			e.m_nextSibling = m_entries[parent].m_firstChild;
+
+			index = static_cast<u32>(m_entries.size());
+			m_entries[parent].m_firstChild = index;
+			m_entries.push_back(e);
+			m_entryIndex.insert(hash, index);
 		}
-	}
 
-	for (Pair<const u64, ZipEntry> &entry : m_entries)
-	{
-		ZipEntry *const e = &entry.second;
-		if (e->m_path != "/")
+		if (slash == StringView::npos)
 		{
-			String directory = trimSlashesAtEnd(trimSlashesAtBegin(e->m_path.substr(0, e->m_path.find_last_of('/'))));
-			ZipEntry *dir = findEntry("/" + directory);
-			assert(dir);
-			dir->addChild(e);
+			return index;
 		}
+		parent = index;
+		begin = slash + 1;
 	}
 }
 
-auto ZipFileSystem::findEntry(const String &path) -> ZipEntry *
+void ZipFileSystem::sortChildren()
 {
-	const u64 hash = prism::city_hash_64(path.c_str() + 1, path.length() - 1);
-
-	auto it = m_entries.find(hash);
-	if (it != m_entries.end())
+	Array<u32> children;
+	for (ZipEntry &directory : m_entries)
 	{
-		return &((*it).second);
-	}
-	return nullptr;
-}
-
-/* ------ ZipEntry ------ */
-
-ZipEntry::ZipEntry()
-{
-}
+		children.clear();
+		for (u32 child = directory.m_firstChild; child != ZipEntry::NONE; child = m_entries[child].m_nextSibling)
+		{
+			children.push_back(child);
+		}
+		if (children.empty())
+		{
+			continue;
+		}
 
-ZipEntry::~ZipEntry()
-{
-}
+		std::sort(children.begin(), children.end(), [this](u32 lhs, u32 rhs)
+		{
+			return m_paths.name(m_entries[lhs].m_path) < m_paths.name(m_entries[rhs].m_path);
+		});
 
-void ZipEntry::addChild(ZipEntry *e)
-{
-	for (Array<ZipEntry *>::iterator it = m_children.begin();
-		 it != m_children.end();
-		 ++it)
-	{
-		ZipEntry *current = (*it);
-		if (e->m_name < current->m_name)
+		directory.m_firstChild = children.front();
+		for (size_t i = 0; i < children.size(); ++i)
 		{
-			m_children.insert(it, e);
-			return;
+			m_entries[children[i]].m_nextSibling = i + 1 < children.size() ? children[i + 1] : ZipEntry::NONE;
 		}
 	}
+}
 
-	m_children.push_back(e);
+auto ZipFileSystem::findEntry(const String &path) -> ZipEntry *
+{
+	const u32 index = m_entryIndex.find(prism::city_hash_64(path.c_str() + 1, path.length() - 1));
+	return index != HashIndex::NOT_FOUND ? &m_entries[index] : nullptr;
 }
 
 /* eof */
@@ -23,10 +23,34 @@
 #pragma once
 
 #include "filesystem.h"
+#include "inflate_index.h"
+#include "hash_index.h"
+#include "path_pool.h"
 
 #include <structs/zip.h>
 
-class ZipEntry;
+/**
+ * Plain record, entries are kept in flat array and stored as they are in mount index.
+ */
+class ZipEntry
+{
+public:
+	static constexpr u32 NONE = UINT32_MAX;
+
+private:
+	u64 m_hash = 0; // CityHash64 of path without leading slash
+	u64 m_size = 0;
+	u64 m_compressedSize = 0;
+	u32 m_offset = 0;
+	u32 m_path = PathPool::ROOT; // node in ZipFileSystem::m_paths
+	u32 m_firstChild = NONE; // children are linked in order of their names
+	u32 m_nextSibling = NONE;
+	bool m_directory = false;
+	bool m_compressed = false;
+
+	friend class ZipFileSystem;
+	friend class ZipFsFile;
+};
 
 class ZipFileSystem : public FileSystem
 {
@@ -42,53 +66,36 @@ public:
 	virtual bool rmdir(const String &directory) override;
 	virtual bool exists(const String &filename) override;
 	virtual bool dirExists(const String &dirpath) override;
-	virtual UniquePtr<List<Entry>> readDir(const String &path, bool absolutePaths, bool recursive) override;
+	virtual bool visitDir(const String &path, bool absolutePaths, bool recursive, const DirVisitor &visitor) override;
 	virtual bool mstat( MetaStat *result, const String &path ) override;
+	virtual bool isReadOnly() const override { return true; }
+	virtual bool visitEntryHashes(const std::function<void(u64 hash)> &visitor) const override;
+	virtual u64 archiveOffset(const String &path) override;
 
-	bool ioRead(void *const buffer, uint64_t bytes, uint64_t offset);
+	bool ioRead(void *const buffer, uint64_t bytes, uint64_t offset); // safe to call from multiple threads
+	const void *ioMap(uint64_t bytes, uint64_t offset) const; // nullptr when root is not memory mapped
+	bool ioCopy(File *output, uint64_t bytes, uint64_t offset); // appends range of root to output inside the OS, false when not possible
+	InflateIndex *inflateIndex(uint64_t offset, uint64_t size) { return m_inflateIndices.get(offset, size); } // checkpoints of compressed stream at given offset
 
 private:
 	void readZip();
-	void processEntry(const String &name, zip::CentralDirectoryFileHeader *entry);
-	ZipEntry *registerEntry(const ZipEntry &entry);
-	void link();
+	void processEntry(StringView name, zip::CentralDirectoryFileHeader *entry); // name is relative to root
+	u32 registerEntry(StringView path, const ZipEntry &entry); // path is relative to root, returns index of the entry
+	void sortChildren();
+	bool readMountIndex(); // loads entries and directory tree from persistent mount index, see Config::s_mountIndexDirectory
+	void writeMountIndex() const;
+	void visitChildren(const ZipEntry &directory, const String &prefix, bool absolutePaths, bool recursive, const DirVisitor &visitor);
 
 	ZipEntry *findEntry(const String &path);
 
 private:
 	String m_rootFilename;
 	UniquePtr<File> m_root;
+	InflateIndexCache m_inflateIndices;
 
-	Map<u64, ZipEntry> m_entries;
-
-};
-
-class ZipEntry
-{
-public:
-	ZipEntry();
-	~ZipEntry();
-
-	void addChild(ZipEntry *e);
-	const String &path() const { return m_path; }
-
-private:
-	bool m_directory;
-
-	String m_path;
-	String m_name;
-
-	uint32_t m_offset = 0;
-
-	bool m_compressed = false;
-
-	size_t m_size = 0;
-	size_t m_compressedSize = 0;
-
-	Array<ZipEntry *> m_children;
-
-	friend class ZipFileSystem;
-	friend class ZipFsFile;
+	Array<ZipEntry> m_entries; // the first one is root directory
+	HashIndex m_entryIndex;
+	PathPool m_paths;
 };
 
 /* eof */
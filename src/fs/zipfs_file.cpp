@@ -26,23 +26,23 @@
 
 #include "zipfilesystem.h"
 
+#include "utils/compression.h"
+
 ZipFsFile::ZipFsFile(const String &filepath, ZipFileSystem *filesystem, const class ZipEntry *entry)
 	: m_filepath(filepath)
 	, m_filesystem(filesystem)
 	, m_entry(entry)
 {
+	// inflate stream is created on first partial read, whole file reads do not need it
 	if (m_entry->m_compressed)
 	{
-		inflateInitialize();
+		m_inflateIndex = m_filesystem->inflateIndex(m_entry->m_offset, m_entry->m_size);
 	}
 }
 
 ZipFsFile::~ZipFsFile()
 {
-	if (m_entry->m_compressed)
-	{
-		inflateDestroy();
-	}
+	inflateDestroy();
 }
 
 uint64_t ZipFsFile::write(const void *buffer, uint64_t elementSize, uint64_t elementCount)
@@ -76,6 +76,16 @@ uint64_t ZipFsFile::read(void *buffer, uint64_t elementSize, uint64_t elementCou
 	}
 	else
 	{
+		if (m_positionCompressed == 0 && (elementSize * elementCount) >= m_entry->m_size && readWhole(buffer))
+		{
+			return m_entry->m_size;
+		}
+
+		if (!m_streamInitialized)
+		{
+			inflateInitialize();
+		}
+
 		const uint64_t chunk = 1024 * 4;
 		uint8_t inbuffer[chunk];
 		uint64_t bufferOffset = 0;
@@ -88,19 +98,29 @@ uint64_t ZipFsFile::read(void *buffer, uint64_t elementSize, uint64_t elementCou
 				break;
 			}
 
-			if (!m_filesystem->ioRead(inbuffer, bytes, m_entry->m_offset + m_positionCompressed))
+			// inflate straight from the archive when it is mapped into memory
+			const void *input = m_filesystem->ioMap(left, m_entry->m_offset + m_positionCompressed);
+			if (input)
+			{
+				bytes = std::min<uint64_t>(left, std::numeric_limits<decltype(m_stream.avail_in)>::max());
+			}
+			else if (m_filesystem->ioRead(inbuffer, bytes, m_entry->m_offset + m_positionCompressed))
+			{
+				input = inbuffer;
+			}
+			else
 			{
 				error("zipfs", m_filepath, "Unable to read from filesystem file");
 				return 0;
 			}
 
 			m_stream.avail_in = static_cast<unsigned int>(bytes);
-			m_stream.next_in = inbuffer;
+			m_stream.next_in = (Bytef *)input;
 
 			m_stream.avail_out = static_cast<unsigned int>((elementSize * elementCount) - bufferOffset);
 			m_stream.next_out = (uint8_t *)buffer + bufferOffset;
 
-			int ret = inflate(&m_stream, Z_NO_FLUSH);
+			int ret = inflate(&m_stream, m_inflateIndex ? Z_BLOCK : Z_NO_FLUSH);
 			assert(ret != Z_STREAM_ERROR);
 
 			if (ret != Z_OK && ret != Z_STREAM_END)
@@ -111,8 +131,19 @@ uint64_t ZipFsFile::read(void *buffer, uint64_t elementSize, uint64_t elementCou
 
 			uint64_t wroteToBuffer = ((elementSize * elementCount) - bufferOffset) - m_stream.avail_out;
 			bufferOffset += wroteToBuffer;
+			m_position += wroteToBuffer;
 			assert(bufferOffset <= (elementSize * elementCount));
 			m_positionCompressed += (bytes - m_stream.avail_in);
+
+			if (ret == Z_STREAM_END)
+			{
+				m_positionCompressed = m_entry->m_compressedSize; // stream resumed from checkpoint does not consume zlib trailer
+				break;
+			}
+			if (m_inflateIndex)
+			{
+				m_inflateIndex->update(m_stream, m_position, m_positionCompressed);
+			}
 		}
 		return bufferOffset;
 	}
@@ -127,18 +158,20 @@ bool ZipFsFile::seek(uint64_t offset, Attrib attr)
 {
 	if (m_entry->m_compressed)
 	{
-		if (offset == 0 && attr == SeekSet)
+		uint64_t position = m_position;
+		if (attr == SeekSet)
 		{
-			if (m_positionCompressed != 0)
-			{
-				inflateDestroy();
-				inflateInitialize();
-			}
-			m_positionCompressed = 0;
-			m_position = 0;
-			return true;
+			position = offset;
+		}
+		else if (attr == SeekCur)
+		{
+			position += offset;
+		}
+		else if (attr == SeekEnd)
+		{
+			position = size() - offset;
 		}
-		return false; // random access is not allowed
+		return inflateSeek(position);
 	}
 	else
 	{
@@ -176,6 +209,88 @@ void ZipFsFile::mstat( MetaStat *result )
 {
 }
 
+const void *ZipFsFile::map(uint64_t offset, uint64_t size) const
+{
+	if (m_entry->m_compressed || offset > m_entry->m_size || size > m_entry->m_size - offset)
+	{
+		return nullptr;
+	}
+	return m_filesystem->ioMap(size, m_entry->m_offset + offset);
+}
+
+bool ZipFsFile::copyRangeTo(File *output, uint64_t offset, uint64_t size)
+{
+	if (m_entry->m_compressed || offset > m_entry->m_size || size > m_entry->m_size - offset)
+	{
+		return false;
+	}
+	return m_filesystem->ioCopy(output, size, m_entry->m_offset + offset);
+}
+
+bool ZipFsFile::readWhole(void *buffer)
+{
+	Array<u8> compressedBuffer;
+	const void *compressed = m_filesystem->ioMap(m_entry->m_compressedSize, m_entry->m_offset);
+	if (!compressed)
+	{
+		compressedBuffer.resize(static_cast<size_t>(m_entry->m_compressedSize));
+		if (!m_filesystem->ioRead(compressedBuffer.data(), compressedBuffer.size(), m_entry->m_offset))
+		{
+			return false;
+		}
+		compressed = compressedBuffer.data();
+	}
+
+	if (!unCompressWhole_deflate(buffer, m_entry->m_size, compressed, m_entry->m_compressedSize))
+	{
+		return false; // let the streaming path report the problem
+	}
+
+	inflateDestroy();
+	m_position = m_entry->m_size;
+	m_positionCompressed = m_entry->m_compressedSize;
+	return true;
+}
+
+bool ZipFsFile::inflateSeek(uint64_t position)
+{
+	if (position > m_entry->m_size)
+	{
+		return false;
+	}
+
+	const auto readByteAt = [this](uint64_t offset, u8 &byte)
+	{
+		if (!m_filesystem->ioRead(&byte, 1, m_entry->m_offset + offset))
+		{
+			error("zipfs", m_filepath, "Unable to read from filesystem file");
+			return false;
+		}
+		return true;
+	};
+	const InflateIndex::SeekResult result = InflateIndex::seek(m_inflateIndex, m_stream, position, m_position, m_positionCompressed,
+		[this]() { inflateDestroy(); }, readByteAt);
+	if (result == InflateIndex::SeekResult::Failed)
+	{
+		error("zipfs", m_filepath, "Failed to resume inflate from checkpoint");
+		return false;
+	}
+	if (result == InflateIndex::SeekResult::Resumed)
+	{
+		m_streamInitialized = true;
+	}
+
+	Array<u8> skipBuffer(static_cast<size_t>(std::min<uint64_t>(position - m_position, 64 * 1024)));
+	while (m_position < position)
+	{
+		if (read(skipBuffer.data(), 1, std::min<uint64_t>(skipBuffer.size(), position - m_position)) == 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
 void ZipFsFile::inflateInitialize()
 {
 	m_stream.zalloc = Z_NULL;
@@ -188,11 +303,16 @@ void ZipFsFile::inflateInitialize()
 		error("zipfs", "", "Failed to inflate init");
 		return;
 	}
+	m_streamInitialized = true;
 }
 
 void ZipFsFile::inflateDestroy()
 {
-	inflateEnd(&m_stream);
+	if (m_streamInitialized)
+	{
+		inflateEnd(&m_stream);
+		m_streamInitialized = false;
+	}
 }
 
 /* eof */
@@ -24,6 +24,8 @@
 
 #include "file.h"
 
+class InflateIndex;
+
 class ZipFsFile : public File
 {
 public:
@@ -43,17 +45,24 @@ public:
 	virtual uint64_t tell() const override;
 	virtual void flush() override;
 	virtual void mstat( MetaStat *result ) override;
+	virtual const void *map(uint64_t offset, uint64_t size) const override;
+	virtual bool copyRangeTo(File *output, uint64_t offset, uint64_t size) override;
 
 private:
 	String			m_filepath;
 	ZipFileSystem * m_filesystem;
 	z_stream		m_stream;
+	bool			m_streamInitialized = false;
+	InflateIndex *	m_inflateIndex = nullptr; // owned by filesystem, nullptr when checkpoints are not used
 	uint64_t		m_position = 0;
 	uint64_t		m_positionCompressed = 0;
 
 	const class ZipEntry *m_entry;
 
 private:
+	bool readWhole(void *buffer);
+	bool inflateSeek(uint64_t position); // resumes from the nearest checkpoint and inflates up to position
+
 	void inflateInitialize();
 	void inflateDestroy();
 
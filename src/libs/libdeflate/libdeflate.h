@@ -0,0 +1,194 @@
+/*
+ * libdeflate.h - public header for libdeflate (decompression API)
+ *
+ * Declarations of the decompression part of libdeflate 1.8, as shipped with
+ * the GDeflate fork from https://github.com/microsoft/DirectStorage
+ * (prebuilt as libs/libs/libdeflate.a and deflate.lib), including the
+ * GDeflate page decompressor added by that fork.
+ *
+ * Copyright 2016 Eric Biggers
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef LIBDEFLATE_H
+#define LIBDEFLATE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LIBDEFLATE_VERSION_MAJOR	1
+#define LIBDEFLATE_VERSION_MINOR	8
+#define LIBDEFLATE_VERSION_STRING	"1.8"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef LIBDEFLATEAPI
+#  define LIBDEFLATEAPI
+#endif
+
+/* ========================================================================== */
+/*                             Decompression                                  */
+/* ========================================================================== */
+
+struct libdeflate_decompressor;
+
+/*
+ * libdeflate_alloc_decompressor() allocates a new decompressor that can be used
+ * for DEFLATE, zlib, and gzip decompression.  The return value is a pointer to
+ * the new decompressor, or NULL if out of memory.
+ *
+ * A single decompressor is not safe to use by multiple threads concurrently.
+ * However, different threads may use different decompressors concurrently.
+ */
+LIBDEFLATEAPI struct libdeflate_decompressor *
+libdeflate_alloc_decompressor(void);
+
+/*
+ * Result of a call to libdeflate_deflate_decompress(),
+ * libdeflate_zlib_decompress(), or libdeflate_gzip_decompress().
+ */
+enum libdeflate_result {
+	/* Decompression was successful.  */
+	LIBDEFLATE_SUCCESS = 0,
+
+	/* Decompressed failed because the compressed data was invalid, corrupt,
+	 * or otherwise unsupported.  */
+	LIBDEFLATE_BAD_DATA = 1,
+
+	/* A NULL 'actual_out_nbytes_ret' was provided, but the data would have
+	 * decompressed to fewer than 'out_nbytes_avail' bytes.  */
+	LIBDEFLATE_SHORT_OUTPUT = 2,
+
+	/* The data would have decompressed to more than 'out_nbytes_avail'
+	 * bytes.  */
+	LIBDEFLATE_INSUFFICIENT_SPACE = 3,
+};
+
+/*
+ * libdeflate_deflate_decompress() decompresses the DEFLATE-compressed stream
+ * from the buffer 'in' with compressed size up to 'in_nbytes' bytes.  The
+ * uncompressed data is written to 'out', a buffer with size 'out_nbytes_avail'
+ * bytes.  If decompression succeeds, then 0 (LIBDEFLATE_SUCCESS) is returned.
+ * Otherwise, a nonzero result code such as LIBDEFLATE_BAD_DATA is returned.  If
+ * a nonzero result code is returned, then the contents of the output buffer are
+ * undefined.
+ *
+ * If 'actual_out_nbytes_ret' is NULL, then the uncompressed size must be known
+ * in advance and be exactly 'out_nbytes_avail'; otherwise
+ * LIBDEFLATE_SHORT_OUTPUT is returned when fewer bytes are produced.
+ * If 'actual_out_nbytes_ret' is not NULL, then the actual uncompressed size is
+ * written to '*actual_out_nbytes_ret'.
+ */
+LIBDEFLATEAPI enum libdeflate_result
+libdeflate_deflate_decompress(struct libdeflate_decompressor *decompressor,
+			      const void *in, size_t in_nbytes,
+			      void *out, size_t out_nbytes_avail,
+			      size_t *actual_out_nbytes_ret);
+
+/*
+ * Like libdeflate_deflate_decompress(), but adds the 'actual_in_nbytes_ret'
+ * argument, which receives the number of compressed bytes actually consumed.
+ */
+LIBDEFLATEAPI enum libdeflate_result
+libdeflate_deflate_decompress_ex(struct libdeflate_decompressor *decompressor,
+				 const void *in, size_t in_nbytes,
+				 void *out, size_t out_nbytes_avail,
+				 size_t *actual_in_nbytes_ret,
+				 size_t *actual_out_nbytes_ret);
+
+/*
+ * Like libdeflate_deflate_decompress(), but assumes the zlib wrapper format
+ * instead of raw DEFLATE.
+ */
+LIBDEFLATEAPI enum libdeflate_result
+libdeflate_zlib_decompress(struct libdeflate_decompressor *decompressor,
+			   const void *in, size_t in_nbytes,
+			   void *out, size_t out_nbytes_avail,
+			   size_t *actual_out_nbytes_ret);
+
+/*
+ * Like libdeflate_zlib_decompress(), but adds the 'actual_in_nbytes_ret'
+ * argument.
+ */
+LIBDEFLATEAPI enum libdeflate_result
+libdeflate_zlib_decompress_ex(struct libdeflate_decompressor *decompressor,
+			      const void *in, size_t in_nbytes,
+			      void *out, size_t out_nbytes_avail,
+			      size_t *actual_in_nbytes_ret,
+			      size_t *actual_out_nbytes_ret);
+
+/*
+ * libdeflate_free_decompressor() frees a decompressor that was allocated with
+ * libdeflate_alloc_decompressor().  If a NULL pointer is passed in, no action
+ * is taken.
+ */
+LIBDEFLATEAPI void
+libdeflate_free_decompressor(struct libdeflate_decompressor *decompressor);
+
+/* ========================================================================== */
+/*                        GDeflate decompression                              */
+/* ========================================================================== */
+
+struct libdeflate_gdeflate_decompressor;
+
+/*
+ * Single page of GDeflate compressed data (one tile of a GDeflate tile stream).
+ */
+struct libdeflate_gdeflate_in_page {
+	const void *data;
+	size_t nbytes;
+};
+
+/*
+ * libdeflate_alloc_gdeflate_decompressor() allocates a new GDeflate
+ * decompressor, or returns NULL if out of memory.  Like the DEFLATE one, it is
+ * not safe to use by multiple threads concurrently.
+ */
+LIBDEFLATEAPI struct libdeflate_gdeflate_decompressor *
+libdeflate_alloc_gdeflate_decompressor(void);
+
+/*
+ * libdeflate_gdeflate_decompress() decompresses 'in_npages' GDeflate pages
+ * into 'out'.  Semantics of the output arguments and of the result match
+ * libdeflate_deflate_decompress().
+ */
+LIBDEFLATEAPI enum libdeflate_result
+libdeflate_gdeflate_decompress(struct libdeflate_gdeflate_decompressor *decompressor,
+			       struct libdeflate_gdeflate_in_page *in_pages, size_t in_npages,
+			       void *out, size_t out_nbytes_avail,
+			       size_t *actual_out_nbytes_ret);
+
+/*
+ * libdeflate_free_gdeflate_decompressor() frees a decompressor that was
+ * allocated with libdeflate_alloc_gdeflate_decompressor().
+ */
+LIBDEFLATEAPI void
+libdeflate_free_gdeflate_decompressor(struct libdeflate_gdeflate_decompressor *decompressor);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBDEFLATE_H */
@@ -77,6 +77,29 @@ void Material::destroy()
 	m_attributes.clear();
 }
 
+size_t Material::memoryUsage() const
+{
+	const auto attributeUsage = [](const Attribute &attribute)
+	{
+		return sizeof(Attribute) + attribute.m_name.capacity() + attribute.m_stringValue.capacity();
+	};
+
+	size_t result = sizeof(Material) + m_effect.capacity() + m_filePath.capacity();
+	for (const Texture &texture : m_textures)
+	{
+		result += sizeof(Texture) + texture.m_texture.capacity() + texture.m_textureName.capacity();
+		for (const Attribute &attribute : texture.m_attributes)
+		{
+			result += attributeUsage(attribute);
+		}
+	}
+	for (const auto &attribute : m_attributes)
+	{
+		result += attribute.first.capacity() + attributeUsage(attribute.second) + 4 * sizeof(void *); // map node
+	}
+	return result;
+}
+
 bool Material::load(String filePath)
 {
 	m_filePath = filePath;
@@ -145,69 +168,58 @@ bool Material::load(String filePath)
 	else
 		loadPre147Format(buffer);
 
-	for (auto &tex : m_textures)
-	{
-		if (!tex.load())
-		{
-			warning("material", m_filePath, "Error in material!");
-		}
-	}
-
 	return true;
 }
 
-String Material::toDeclaration(const String &prefix) const
+String Material::toDeclaration(const String &alias, const String &prefix) const
 {
 	String result;
 	result += prefix + "Material {\n";
 	{
-		result += prefix + fmt::sprintf(TAB "Alias: \"%s\"\n", alias().c_str());
+		result += prefix + fmt::sprintf(TAB "Alias: \"%s\"\n", alias.c_str());
 		result += prefix + fmt::sprintf(TAB "Effect: \"%s\"\n", m_effect.c_str());
 	}
 	result += prefix + "}\n";
 	return result;
 }
 
-Pix::Value Material::toPixDefinition() const
+Pix::Value Material::toPixDefinition(const String &alias) const
 {
 	if (s_outputMatFormat147Enabled)
 	{
-		return toPixDefinitionPost147();
+		return toPixDefinitionPost147(alias);
 	}
 	else
 	{
-		return toPixDefinitionPre147();
+		return toPixDefinitionPre147(alias);
 	}
 }
 
-Pix::Value Material::toPixDeclaration() const
+Pix::Value Material::toPixDeclaration(const String &alias) const
 {
 	Pix::Value root;
-	root["Alias"] = alias();
+	root["Alias"] = alias;
 	root["Effect"] = m_effect;
 	return root;
 }
 
-String Material::alias() const
-{
-	return m_alias;
-}
-
-void Material::setAlias(String name)
-{
-	m_alias = name;
-}
-
 bool Material::convertTextures(String exportPath) const
 {
+	bool result = true;
 	for (auto &texture : m_textures)
 	{
-		if (texture.texobj())
+		const SharedPtr<TextureObject> texobj = texture.texobj();
+		if (texobj)
 		{
-			texture.texobj()->saveToMidFormats(exportPath);
+			texobj->saveToMidFormats(exportPath);
+		}
+		else
+		{
+			warning("material", m_filePath, "Error in material!");
+			result = false;
 		}
 	}
-	return true;
+	return result;
 }
 
 void Material::setValues(Material::Attribute &attrib, const Array<String> &values, const int startIndex)
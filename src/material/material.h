@@ -53,24 +53,23 @@ public:
 	void loadPost147Format(String &content);
 	void destroy();
 
-	String toDeclaration(const String &prefix = "") const;
-
-	Pix::Value toPixDefinition() const;
-	Pix::Value toPixDefinitionPre147() const;
-	Pix::Value toPixDefinitionPost147() const;
-	Pix::Value toPixDeclaration() const;
-
 	/**
-	 * @brief Creates alias of material
-	 *
-	 * @return @c The alias of material
+	 * Loaded materials are shared by all looks and models using them (see ResourceLibrary::obtainMaterial),
+	 * so the alias, which differs per model, is given by the caller.
 	 */
-	String alias() const;
+	String toDeclaration(const String &alias, const String &prefix = "") const;
 
-	void setAlias(String name);
+	Pix::Value toPixDefinition(const String &alias) const;
+	Pix::Value toPixDefinitionPre147(const String &alias) const;
+	Pix::Value toPixDefinitionPost147(const String &alias) const;
+	Pix::Value toPixDeclaration(const String &alias) const;
+
+	String filePath() const { return m_filePath; }
 
 	bool convertTextures(String exportPath) const;
 
+	size_t memoryUsage() const; // approximate, used by ResourceLibrary to keep within its budget
+
 	static void setValues(Material::Attribute &attrib, const Array<String> &values, const int startIndex = 0);
 
 	using AttributesMap = Map<String, Attribute>;
@@ -82,7 +81,6 @@ private:
 	Array<Texture> m_textures;
 	AttributesMap m_attributes;
 	String m_filePath;		// @example: /material/example.mat
-	String m_alias;
 
 	friend Model;
 };
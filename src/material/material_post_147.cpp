@@ -155,10 +155,10 @@ void Material::loadPost147Format(String& content)
 	}
 }
 
-Pix::Value Material::toPixDefinitionPost147() const
+Pix::Value Material::toPixDefinitionPost147(const String &alias) const
 {
 	Pix::Value root;
-	root["Alias"] = alias();
+	root["Alias"] = alias;
 	root["Effect"] = m_effect;
 	root["Flags"] = 0;
 	root["AttributeCount"] = m_attributes.size();
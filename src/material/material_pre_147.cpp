@@ -136,13 +136,13 @@ void Material::loadPre147Format(String& content)
 	}
 }
 
-Pix::Value Material::toPixDefinitionPre147() const
+Pix::Value Material::toPixDefinitionPre147(const String &alias) const
 {
 	AttributesMap pre147Attributes;
 	MaterialConverter147::convertAttributesToPre147Format(m_effect, m_attributes, pre147Attributes);
 
 	Pix::Value root;
-	root["Alias"] = alias();
+	root["Alias"] = alias;
 	root["Effect"] = m_effect;
 	root["Flags"] = 0;
 	root["AttributeCount"] = pre147Attributes.size();
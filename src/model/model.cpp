@@ -33,6 +33,7 @@
 #include <texture/texture.h>
 #include <prefab/prefab.h>
 #include <model/collision.h>
+#include <model/vertex_decoder.h>
 
 #include <structs/pmg_0x13.h>
 #include <structs/pmg_0x14.h>
@@ -219,13 +220,12 @@ bool Model::loadModel0x13(const uint8_t *const buffer, const size_t size)
 					i, piece->m_bone_count, Vertex::BONE_COUNT);
 		}
 
-		currentPiece->m_vertices.resize(piece->m_verts);
 		m_vertCount += piece->m_verts;
 
 		currentPiece->m_triangles.resize(piece->m_edges / 3);
 		m_triangleCount += (piece->m_edges / 3);
 
-		m_skinVertCount += currentPiece->m_bones > 0 ? currentPiece->m_vertices.size() : 0;
+		m_skinVertCount += currentPiece->m_bones > 0 ? piece->m_verts : 0;
 
 		uint32_t poolSizeStatic = 0;
 		uint32_t poolSizeDynamic = 0;
@@ -273,64 +273,40 @@ bool Model::loadModel0x13(const uint8_t *const buffer, const size_t size)
 			poolSizeDynamic = poolSizeStatic;
 		}
 
-		for (int32_t j = 0; j < piece->m_verts; ++j)
+		VertexDecoder decoder;
+		if (currentPiece->m_position)
 		{
-			Vertex *const vert = &currentPiece->m_vertices[j];
-
-			if (currentPiece->m_position)
-			{
-				vert->m_position = *(const float3 *)(buffer + piece->m_vert_position_offset + poolSizeStatic*j);
-			}
-			if (currentPiece->m_normal)
-			{
-				vert->m_normal = *(const float3 *)(buffer + piece->m_vert_normal_offset + poolSizeStatic*j);
-			}
-			if (currentPiece->m_tangent)
-			{
-				const auto vertTangent = (const pmg_vert_tangent_t *)(buffer + piece->m_vert_tangent_offset + poolSizeStatic*j);
-				vert->m_tangent[0] = vertTangent->w;
-				vert->m_tangent[1] = vertTangent->x;
-				vert->m_tangent[2] = vertTangent->y;
-				vert->m_tangent[3] = vertTangent->z;
-			}
-			if (currentPiece->m_texcoord)
-			{
-				for (int32_t k = 0; k < piece->m_uv_channels; ++k)
-				{
-					vert->m_texcoords[k] = *(float2 *)(buffer + piece->m_vert_uv_offset + poolSizeDynamic*j + sizeof(float2)*k);
-				}
-			}
-			if (currentPiece->m_color)
-			{
-				const auto vertRgba = (const pmg_vert_color_t *)(buffer + piece->m_vert_rgba_offset + poolSizeDynamic*j);
-				vert->m_color[0] = 2.f * vertRgba->m_r / 255.f;
-				vert->m_color[1] = 2.f * vertRgba->m_g / 255.f;
-				vert->m_color[2] = 2.f * vertRgba->m_b / 255.f;
-				vert->m_color[3] = vertRgba->m_a / 255.f;
-			}
-			if (currentPiece->m_factor)
-			{
-				const auto vertFactor = (const pmg_vert_factor_t *)(buffer + piece->m_vert_factor_offset + poolSizeDynamic*j);
-				vert->m_factor[0] = vertFactor->a[0];
-				vert->m_factor[1] = vertFactor->a[1];
-				vert->m_factor[2] = vertFactor->a[2];
-				vert->m_factor[3] = vertFactor->a[3];
-			}
-			if (piece->m_anim_bind_offset != -1)
-			{
-				const auto animBind = *(const uint16_t *)(buffer + piece->m_anim_bind_offset + j * sizeof(uint16_t));
-				for (int k = 0; k < std::min(piece->m_bone_count, (i32)Vertex::BONE_COUNT); ++k)
-				{
-					vert->m_boneIndex[k] = *(const uint8_t *)(buffer + piece->m_anim_bind_bones_offset + (animBind * piece->m_bone_count) + k);
-					vert->m_boneWeight[k] = *(const uint8_t *)(buffer + piece->m_anim_bind_bones_weight_offset + (animBind * piece->m_bone_count) + k);
-				}
-				for (int k = std::min(piece->m_bone_count, (i32)Vertex::BONE_COUNT); k < Vertex::BONE_COUNT; ++k)
-				{
-					vert->m_boneIndex[k] = 0xff;
-					vert->m_boneWeight[k] = 0;
-				}
-			}
+			decoder.m_position = { buffer + piece->m_vert_position_offset, poolSizeStatic };
+		}
+		if (currentPiece->m_normal)
+		{
+			decoder.m_normal = { buffer + piece->m_vert_normal_offset, poolSizeStatic };
+		}
+		if (currentPiece->m_tangent)
+		{
+			decoder.m_tangent = { buffer + piece->m_vert_tangent_offset, poolSizeStatic };
+		}
+		if (currentPiece->m_texcoord)
+		{
+			decoder.m_texcoord = { buffer + piece->m_vert_uv_offset, poolSizeDynamic };
+			decoder.m_texcoordCount = piece->m_uv_channels;
+		}
+		if (currentPiece->m_color)
+		{
+			decoder.m_color = { buffer + piece->m_vert_rgba_offset, poolSizeDynamic };
 		}
+		if (currentPiece->m_factor)
+		{
+			decoder.m_factor = { buffer + piece->m_vert_factor_offset, poolSizeDynamic };
+		}
+		if (piece->m_anim_bind_offset != -1)
+		{
+			decoder.m_animBind = { buffer + piece->m_anim_bind_offset, sizeof(uint16_t) };
+			decoder.m_animBindIndexes = buffer + piece->m_anim_bind_bones_offset;
+			decoder.m_animBindWeights = buffer + piece->m_anim_bind_bones_weight_offset;
+			decoder.m_animBindBoneCount = std::max(piece->m_bone_count, 0);
+		}
+		decoder.decode(currentPiece->m_vertices, piece->m_verts);
 
 		auto triangle = (const pmg_triangle_t *)(buffer + piece->m_triangle_offset);
 		for (int32_t j = 0; j < (piece->m_edges / 3); ++j, ++triangle)
@@ -437,13 +413,12 @@ bool Model::loadModel0x14(const uint8_t *const buffer, const size_t size)
 		currentPiece->m_bones = header->m_weight_width;
 		currentPiece->m_material = piece->m_material;
 
-		currentPiece->m_vertices.resize(piece->m_verts);
 		m_vertCount += piece->m_verts;
 
 		currentPiece->m_triangles.resize(piece->m_edges / 3);
 		m_triangleCount += (piece->m_edges / 3);
 
-		m_skinVertCount += currentPiece->m_bones > 0 ? currentPiece->m_vertices.size() : 0;
+		m_skinVertCount += currentPiece->m_bones > 0 ? piece->m_verts : 0;
 
 		uint32_t poolSize = 0;
 
@@ -488,66 +463,38 @@ bool Model::loadModel0x14(const uint8_t *const buffer, const size_t size)
 			poolSize += 2 * sizeof(uint32_t);
 		}
 
-		for (int32_t j = 0; j < piece->m_verts; ++j)
+		VertexDecoder decoder;
+		if (currentPiece->m_position)
 		{
-			Vertex *vert = &currentPiece->m_vertices[j];
-
-			if (currentPiece->m_position)
-			{
-				vert->m_position = *(const float3 *)(buffer + piece->m_vert_position_offset + poolSize*j);
-			}
-			if (currentPiece->m_normal)
-			{
-				vert->m_normal = *(const float3 *)(buffer + piece->m_vert_normal_offset + poolSize*j);
-			}
-			if (currentPiece->m_tangent)
-			{
-				const auto vertTangent = (const pmg_vert_tangent_t *)(buffer + piece->m_vert_tangent_offset + poolSize*j);
-				vert->m_tangent[0] = vertTangent->w;
-				vert->m_tangent[1] = vertTangent->x;
-				vert->m_tangent[2] = vertTangent->y;
-				vert->m_tangent[3] = vertTangent->z;
-			}
-			if (currentPiece->m_texcoord)
-			{
-				for (int32_t k = 0; k < piece->m_texcoord_width; ++k)
-				{
-					vert->m_texcoords[k] = *(float2 *)(buffer + piece->m_vert_texcoord_offset + poolSize*j + sizeof(float2)*k);
-				}
-			}
-			if (currentPiece->m_color)
-			{
-				const auto vertRgba = (const pmg_vert_color_t *)(buffer + piece->m_vert_color_offset + poolSize*j);
-				vert->m_color[0] = 2.f * vertRgba->r / 255.f;
-				vert->m_color[1] = 2.f * vertRgba->g / 255.f;
-				vert->m_color[2] = 2.f * vertRgba->b / 255.f;
-				vert->m_color[3] = vertRgba->a / 255.f;
-			}
-			if (currentPiece->m_factor)
-			{
-				const auto vertFactor = (const pmg_vert_factor_t *)(buffer + piece->m_vert_factor_offset + poolSize*j);
-				vert->m_factor[0] = vertFactor->a[0];
-				vert->m_factor[1] = vertFactor->a[1];
-				vert->m_factor[2] = vertFactor->a[2];
-				vert->m_factor[3] = vertFactor->a[3];
-			}
-			if (piece->m_vert_bone_index_offset != -1 && piece->m_vert_bone_weight_offset != -1)
-			{
-				for (int bone = 0; bone < 4; ++bone)
-				{
-					const uint32_t indexes = *(const uint32_t *)(buffer + piece->m_vert_bone_index_offset + poolSize*j);
-					vert->m_boneIndex[bone] = (indexes >> (8 * bone)) & 0xff;
-
-					const uint32_t weights = *(const uint32_t *)(buffer + piece->m_vert_bone_weight_offset + poolSize*j);
-					vert->m_boneWeight[bone] = (weights >> (8 * bone)) & 0xff;
-				}
-				for (int bone = 4; bone < Vertex::BONE_COUNT; ++bone)
-				{
-					vert->m_boneIndex[bone] = 0xff;
-					vert->m_boneWeight[bone] = 0;
-				}
-			}
+			decoder.m_position = { buffer + piece->m_vert_position_offset, poolSize };
+		}
+		if (currentPiece->m_normal)
+		{
+			decoder.m_normal = { buffer + piece->m_vert_normal_offset, poolSize };
+		}
+		if (currentPiece->m_tangent)
+		{
+			decoder.m_tangent = { buffer + piece->m_vert_tangent_offset, poolSize };
+		}
+		if (currentPiece->m_texcoord)
+		{
+			decoder.m_texcoord = { buffer + piece->m_vert_texcoord_offset, poolSize };
+			decoder.m_texcoordCount = piece->m_texcoord_width;
+		}
+		if (currentPiece->m_color)
+		{
+			decoder.m_color = { buffer + piece->m_vert_color_offset, poolSize };
+		}
+		if (currentPiece->m_factor)
+		{
+			decoder.m_factor = { buffer + piece->m_vert_factor_offset, poolSize };
+		}
+		if (piece->m_vert_bone_index_offset != -1 && piece->m_vert_bone_weight_offset != -1)
+		{
+			decoder.m_boneIndex = { buffer + piece->m_vert_bone_index_offset, poolSize };
+			decoder.m_boneWeight = { buffer + piece->m_vert_bone_weight_offset, poolSize };
 		}
+		decoder.decode(currentPiece->m_vertices, piece->m_verts);
 
 		auto triangle = (const pmg_index_t *)(buffer + piece->m_index_offset);
 		for (int32_t j = 0; j < (piece->m_edges / 3); ++j, ++triangle)
@@ -654,13 +601,12 @@ bool Model::loadModel0x15(const uint8_t *const buffer, const size_t size)
 		currentPiece->m_bones = header->m_weight_width;
 		currentPiece->m_material = piece->m_material;
 
-		currentPiece->m_vertices.resize(piece->m_verts);
 		m_vertCount += piece->m_verts;
 
 		currentPiece->m_triangles.resize(piece->m_edges / 3);
 		m_triangleCount += (piece->m_edges / 3);
 
-		m_skinVertCount += currentPiece->m_bones > 0 ? currentPiece->m_vertices.size() : 0;
+		m_skinVertCount += currentPiece->m_bones > 0 ? piece->m_verts : 0;
 
 		uint32_t poolSize = 0;
 
@@ -705,66 +651,38 @@ bool Model::loadModel0x15(const uint8_t *const buffer, const size_t size)
 			poolSize += 2 * sizeof(uint32_t);
 		}
 
-		for (int32_t j = 0; j < piece->m_verts; ++j)
+		VertexDecoder decoder;
+		if (currentPiece->m_position)
 		{
-			Vertex *vert = &currentPiece->m_vertices[j];
-
-			if (currentPiece->m_position)
-			{
-				vert->m_position = *(const float3 *)(buffer + piece->m_vert_position_offset + poolSize*j);
-			}
-			if (currentPiece->m_normal)
-			{
-				vert->m_normal = *(const float3 *)(buffer + piece->m_vert_normal_offset + poolSize*j);
-			}
-			if (currentPiece->m_tangent)
-			{
-				const auto vertTangent = (const pmg_vert_tangent_t *)(buffer + piece->m_vert_tangent_offset + poolSize*j);
-				vert->m_tangent[0] = vertTangent->w;
-				vert->m_tangent[1] = vertTangent->x;
-				vert->m_tangent[2] = vertTangent->y;
-				vert->m_tangent[3] = vertTangent->z;
-			}
-			if (currentPiece->m_texcoord)
-			{
-				for (int32_t k = 0; k < piece->m_texcoord_width; ++k)
-				{
-					vert->m_texcoords[k] = *(float2 *)(buffer + piece->m_vert_texcoord_offset + poolSize*j + sizeof(float2)*k);
-				}
-			}
-			if (currentPiece->m_color)
-			{
-				const auto vertRgba = (const pmg_vert_color_t *)(buffer + piece->m_vert_color_offset + poolSize*j);
-				vert->m_color[0] = 2.f * vertRgba->r / 255.f;
-				vert->m_color[1] = 2.f * vertRgba->g / 255.f;
-				vert->m_color[2] = 2.f * vertRgba->b / 255.f;
-				vert->m_color[3] = vertRgba->a / 255.f;
-			}
-			if (currentPiece->m_factor)
-			{
-				const auto vertFactor = (const pmg_vert_factor_t *)(buffer + piece->m_vert_factor_offset + poolSize*j);
-				vert->m_factor[0] = vertFactor->a[0];
-				vert->m_factor[1] = vertFactor->a[1];
-				vert->m_factor[2] = vertFactor->a[2];
-				vert->m_factor[3] = vertFactor->a[3];
-			}
-			if (piece->m_vert_bone_index_offset != -1 && piece->m_vert_bone_weight_offset != -1)
-			{
-				for (int bone = 0; bone < 4; ++bone)
-				{
-					const uint32_t indexes = *(const uint32_t *)(buffer + piece->m_vert_bone_index_offset + poolSize*j);
-					vert->m_boneIndex[bone] = (indexes >> (8 * bone)) & 0xff;
-
-					const uint32_t weights = *(const uint32_t *)(buffer + piece->m_vert_bone_weight_offset + poolSize*j);
-					vert->m_boneWeight[bone] = (weights >> (8 * bone)) & 0xff;
-				}
-				for (int bone = 4; bone < Vertex::BONE_COUNT; ++bone)
-				{
-					vert->m_boneIndex[bone] = 0xff;
-					vert->m_boneWeight[bone] = 0;
-				}
-			}
+			decoder.m_position = { buffer + piece->m_vert_position_offset, poolSize };
+		}
+		if (currentPiece->m_normal)
+		{
+			decoder.m_normal = { buffer + piece->m_vert_normal_offset, poolSize };
+		}
+		if (currentPiece->m_tangent)
+		{
+			decoder.m_tangent = { buffer + piece->m_vert_tangent_offset, poolSize };
+		}
+		if (currentPiece->m_texcoord)
+		{
+			decoder.m_texcoord = { buffer + piece->m_vert_texcoord_offset, poolSize };
+			decoder.m_texcoordCount = piece->m_texcoord_width;
+		}
+		if (currentPiece->m_color)
+		{
+			decoder.m_color = { buffer + piece->m_vert_color_offset, poolSize };
+		}
+		if (currentPiece->m_factor)
+		{
+			decoder.m_factor = { buffer + piece->m_vert_factor_offset, poolSize };
+		}
+		if (piece->m_vert_bone_index_offset != -1 && piece->m_vert_bone_weight_offset != -1)
+		{
+			decoder.m_boneIndex = { buffer + piece->m_vert_bone_index_offset, poolSize };
+			decoder.m_boneWeight = { buffer + piece->m_vert_bone_weight_offset, poolSize };
 		}
+		decoder.decode(currentPiece->m_vertices, piece->m_verts);
 
 		auto triangle = (const pmg_index_t *)(buffer + piece->m_index_offset);
 		for (int32_t j = 0; j < (piece->m_edges / 3); ++j, ++triangle)
@@ -822,28 +740,29 @@ bool Model::loadDescriptor()
 			uint32_t currentOffsetMat = ((i*header->m_material_count) + j)*sizeof(uint32_t);
 			uint32_t offsetMaterial = *(uint32_t *)(buffer.get() + header->m_material_offset + currentOffsetMat);
 			const char *materialPath = (const char *)(buffer.get() + offsetMaterial);
-			currentLook->m_materials[j].load(materialPath[0] == '/' ? materialPath : (m_directory + "/" + materialPath));
+			Look::MaterialReference &material = currentLook->m_materials[j];
+			material.m_material = ResourceLibrary::Get()->obtainMaterial(materialPath[0] == '/' ? materialPath : (m_directory + "/" + materialPath));
 			if (i == 0)
 			{
-				if (currentLook->m_materials[j].m_textures.size() > 0)
+				if (material.m_material->m_textures.size() > 0)
 				{
-					String textureName = String(currentLook->m_materials[j].m_textures[0].texture().c_str());
+					String textureName = String(material.m_material->m_textures[0].texture().c_str());
 					textureName = textureName.substr(0, textureName.size() - 5);
 					size_t lastSlash = textureName.rfind('/');
 					if (lastSlash != String::npos)
 					{
 						textureName = textureName.substr(lastSlash + 1);
 					}
-					currentLook->m_materials[j].setAlias(fmt::sprintf("mat_%04i_%s", j, textureName.c_str()).c_str());
+					material.m_alias = fmt::sprintf("mat_%04i_%s", j, textureName.c_str()).c_str();
 				}
 				else
 				{
-					currentLook->m_materials[j].setAlias(fmt::sprintf("mat_%04i", j).c_str());
+					material.m_alias = fmt::sprintf("mat_%04i", j).c_str();
 				}
 			}
 			else
 			{
-				currentLook->m_materials[j].setAlias(m_looks[0].m_materials[j].alias());
+				material.m_alias = m_looks[0].m_materials[j].m_alias;
 			}
 		}
 	}
@@ -1156,7 +1075,7 @@ bool Model::saveToPim(String exportPath) const
 	{
 		for (uint32_t i = 0; i < m_materialCount; ++i)
 		{
-			*file << m_looks[0].m_materials[i].toDeclaration();
+			*file << m_looks[0].m_materials[i].m_material->toDeclaration(m_looks[0].m_materials[i].m_alias);
 		}
 	}
 
@@ -1524,7 +1443,7 @@ bool Model::saveToPit(String exportPath) const
 		look["Name"] = l.m_name;
 		for (const auto &mat : l.m_materials)
 		{
-			look["Material"] = mat.toPixDefinition();
+			look["Material"] = mat.m_material->toPixDefinition(mat.m_alias);
 		}
 	}
 
@@ -1614,7 +1533,7 @@ void Model::convertTextures(String exportPath) const
 	{
 		for (size_t j = 0; j < m_looks[i].m_materials.size(); ++j)
 		{
-			m_looks[i].m_materials[j].convertTextures(exportPath);
+			m_looks[i].m_materials[j].m_material->convertTextures(exportPath);
 		}
 	}
 }
@@ -81,6 +81,7 @@ public:
 	String fileDirectory() const { return m_directory; }
 
 	uint32_t boneCount() const { return m_bones.size(); }
+	uint32_t vertexCount() const { return m_vertCount; }
 	Bone *bone(size_t index);
 
 	const Array<Part> &getParts() const { return m_parts; }
@@ -95,8 +96,14 @@ private:
 class Look
 {
 private:
+	struct MaterialReference
+	{
+		SharedPtr<const Material> m_material; // shared with other looks and models
+		String m_alias;
+	};
+
 	String m_name;
-	Array<Material> m_materials;
+	Array<MaterialReference> m_materials;
 
 	friend Model;
 };
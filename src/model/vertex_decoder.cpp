@@ -0,0 +1,119 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/model/vertex_decoder.cpp
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+#include <prerequisites.h>
+
+#include "vertex_decoder.h"
+
+#include <emmintrin.h>
+
+namespace
+{
+	__m128 unpackBytes(const uint8_t *source)
+	{
+		int32_t packed;
+		memcpy(&packed, source, sizeof(packed));
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i words = _mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero);
+		return _mm_cvtepi32_ps(_mm_unpacklo_epi16(words, zero));
+	}
+} // namespace
+
+void VertexDecoder::decode(Array<Vertex> &vertices, size_t count) const
+{
+	static_assert(Vertex::BONE_COUNT == 8, "Bones are unpacked as 8 bytes per vertex");
+
+	// streams are copied, stores of bytes to vertices would make compiler reload them from members every vertex
+	const Stream position = m_position;
+	const Stream normal = m_normal;
+	const Stream tangent = m_tangent;
+	const Stream texcoord = m_texcoord;
+	const Stream color = m_color;
+	const Stream factor = m_factor;
+	const Stream boneIndex = m_boneIndex;
+	const Stream boneWeight = m_boneWeight;
+	const Stream animBind = m_animBind;
+	const size_t texcoordCount = std::min(m_texcoordCount, size_t(Vertex::TEXCOORD_COUNT));
+	const size_t animBindBoneCount = std::min(m_animBindBoneCount, size_t(Vertex::BONE_COUNT));
+
+	// same operations as 2.f * r / 255.f, so colors do not differ from the scalar conversion
+	const __m128 colorScale = _mm_setr_ps(2.f, 2.f, 2.f, 1.f);
+	const __m128 colorDivisor = _mm_set1_ps(255.f);
+
+	vertices.reserve(vertices.size() + count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		vertices.emplace_back();
+		Vertex *const vert = &vertices.back();
+
+		if (position.m_data)
+		{
+			memcpy(&vert->m_position, position.m_data + position.m_stride * i, sizeof(Float3));
+		}
+		if (normal.m_data)
+		{
+			memcpy(&vert->m_normal, normal.m_data + normal.m_stride * i, sizeof(Float3));
+		}
+		if (tangent.m_data)
+		{
+			_mm_storeu_ps(&vert->m_tangent[0], _mm_loadu_ps(reinterpret_cast<const float *>(tangent.m_data + tangent.m_stride * i)));
+		}
+		if (texcoord.m_data)
+		{
+			for (size_t k = 0; k < texcoordCount; ++k)
+			{
+				memcpy(&vert->m_texcoords[k], texcoord.m_data + texcoord.m_stride * i + sizeof(Float2) * k, sizeof(Float2));
+			}
+		}
+		if (color.m_data)
+		{
+			const __m128 rgba = unpackBytes(color.m_data + color.m_stride * i);
+			_mm_storeu_ps(&vert->m_color[0], _mm_div_ps(_mm_mul_ps(rgba, colorScale), colorDivisor));
+		}
+		if (factor.m_data)
+		{
+			_mm_storeu_ps(&vert->m_factor[0], unpackBytes(factor.m_data + factor.m_stride * i));
+		}
+		if (boneIndex.m_data && boneWeight.m_data)
+		{
+			// bytes of the packed words are kept as they are, remaining bones get index 0xff and weight 0
+			uint32_t indexes, weights;
+			memcpy(&indexes, boneIndex.m_data + boneIndex.m_stride * i, sizeof(indexes));
+			memcpy(&weights, boneWeight.m_data + boneWeight.m_stride * i, sizeof(weights));
+			const uint64_t unpackedIndexes = 0xffffffff00000000ull | indexes;
+			const uint64_t unpackedWeights = weights;
+			memcpy(vert->m_boneIndex, &unpackedIndexes, sizeof(unpackedIndexes));
+			memcpy(vert->m_boneWeight, &unpackedWeights, sizeof(unpackedWeights));
+		}
+		if (animBind.m_data)
+		{
+			uint16_t bind;
+			memcpy(&bind, animBind.m_data + animBind.m_stride * i, sizeof(bind));
+			memset(vert->m_boneIndex, 0xff, Vertex::BONE_COUNT);
+			memset(vert->m_boneWeight, 0, Vertex::BONE_COUNT);
+			memcpy(vert->m_boneIndex, m_animBindIndexes + bind * m_animBindBoneCount, animBindBoneCount);
+			memcpy(vert->m_boneWeight, m_animBindWeights + bind * m_animBindBoneCount, animBindBoneCount);
+		}
+	}
+}
+
+/* eof */
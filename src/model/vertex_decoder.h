@@ -0,0 +1,66 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/model/vertex_decoder.h
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+#pragma once
+
+#include "piece.h"
+
+/**
+ * @brief Decodes interleaved vertex streams of a pmg piece
+ *
+ * Loaders describe where each stream of the piece starts and its stride, streams left empty are not present.
+ * Every vertex is constructed right before it is decoded, so it is written to memory once.
+ */
+class VertexDecoder
+{
+public:
+	struct Stream
+	{
+		const uint8_t *m_data = nullptr; // attribute of the first vertex
+		size_t m_stride = 0;
+	};
+
+public:
+	Stream m_position;		// float3
+	Stream m_normal;		// float3
+	Stream m_tangent;		// float4 w, x, y, z
+	Stream m_texcoord;		// float2[m_texcoordCount]
+	Stream m_color;			// rgba8, rgb is scaled by 2
+	Stream m_factor;		// u8[4]
+	Stream m_boneIndex;		// 4 x 8 bit bone indexes, m_boneWeight has to be present as well
+	Stream m_boneWeight;	// 4 x 8 bit bone weights
+	Stream m_animBind;		// u16 row of m_animBindIndexes and m_animBindWeights tables
+
+	size_t m_texcoordCount = 0;
+
+	const uint8_t *m_animBindIndexes = nullptr;
+	const uint8_t *m_animBindWeights = nullptr;
+	size_t m_animBindBoneCount = 0;
+
+public:
+	/**
+	 * @brief Appends count vertices decoded from the streams
+	 */
+	void decode(Array<Vertex> &vertices, size_t count) const;
+};
+
+/* eof */
@@ -60,6 +60,11 @@
 #include <optional>
 #include <functional>
 #include <type_traits>
+#include <limits>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
 
 //
 /// Utils
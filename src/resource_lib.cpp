@@ -24,30 +24,171 @@
 
 #include "resource_lib.h"
 
+#include <texture/texture.h>
 #include <texture/texture_object.h>
 #include <fs/uberfilesystem.h>
 
+#include <config.h>
+
 auto ResourceLibrary::obtain(String tobjfile) -> Entry
 {
-	if (m_tobjs.find(tobjfile) == m_tobjs.end())
+	const u64 hash = prism::city_hash_64(tobjfile.c_str(), tobjfile.length());
+	Shard &tobjShard = m_shards[hash % SHARD_COUNT];
+
+	SharedPtr<Slot> slot;
+	bool exported = false;
+	bool missing = false;
+	{
+		std::lock_guard<std::mutex> lock(tobjShard.m_mutex);
+		auto found = tobjShard.m_tobjs.find(tobjfile);
+		if (found != tobjShard.m_tobjs.end())
+		{
+			tobjShard.m_lru.splice(tobjShard.m_lru.begin(), tobjShard.m_lru, found->second);
+			slot = found->second->second;
+		}
+		else
+		{
+			slot = std::make_shared<Slot>();
+			slot->m_hash = hash;
+			tobjShard.m_lru.emplace_front(tobjfile, slot);
+			tobjShard.m_tobjs[tobjfile] = tobjShard.m_lru.begin();
+			exported = tobjShard.m_exported.find(hash) != HashIndex::NOT_FOUND;
+			missing = tobjShard.m_missing.find(hash) != HashIndex::NOT_FOUND;
+		}
+	}
+
+	// loaded outside of the shard lock, so other tobjs of the shard are not blocked meanwhile
+	std::call_once(slot->m_loaded, [&]
 	{
+		if (missing)
+		{
+			return; // already reported
+		}
 		Entry texobj = std::make_shared<TextureObject>();
 		if (texobj->load(tobjfile))
 		{
-			m_tobjs.insert({ tobjfile.c_str(), texobj });
+			if (exported)
+			{
+				texobj->markExported();
+			}
+			slot->m_tobj = std::move(texobj);
 		}
 		else
 		{
 			warning("tobj", tobjfile, "Unable to load!");
-			return nullptr;
 		}
+	});
+
+	std::lock_guard<std::mutex> lock(tobjShard.m_mutex);
+	if (slot->m_size == 0)
+	{
+		slot->m_size = sizeof(Slot) + tobjfile.capacity() + (slot->m_tobj ? slot->m_tobj->memoryUsage() : 0);
+		tobjShard.m_bytes += slot->m_size;
+		evict(tobjShard);
+	}
+	return slot->m_tobj;
+}
+
+auto ResourceLibrary::obtainMaterial(String matfile) -> MaterialEntry
+{
+	const u64 hash = prism::city_hash_64(matfile.c_str(), matfile.length());
+	Shard &materialShard = m_shards[hash % SHARD_COUNT];
+
+	SharedPtr<MaterialSlot> slot;
+	{
+		std::lock_guard<std::mutex> lock(materialShard.m_mutex);
+		auto found = materialShard.m_materials.find(matfile);
+		if (found != materialShard.m_materials.end())
+		{
+			materialShard.m_materialLru.splice(materialShard.m_materialLru.begin(), materialShard.m_materialLru, found->second);
+			slot = found->second->second;
+		}
+		else
+		{
+			slot = std::make_shared<MaterialSlot>();
+			materialShard.m_materialLru.emplace_front(matfile, slot);
+			materialShard.m_materials[matfile] = materialShard.m_materialLru.begin();
+		}
+	}
+
+	std::call_once(slot->m_loaded, [&]
+	{
+		slot->m_material = std::make_shared<Material>();
+		slot->m_failed = !slot->m_material->load(matfile);
+	});
+
+	std::lock_guard<std::mutex> lock(materialShard.m_mutex);
+	if (slot->m_size == 0)
+	{
+		slot->m_size = sizeof(MaterialSlot) + matfile.capacity() + slot->m_material->memoryUsage();
+		materialShard.m_bytes += slot->m_size;
+		evict(materialShard);
 	}
-	return m_tobjs[tobjfile];
+	return slot->m_material;
 }
 
 void ResourceLibrary::destroy()
 {
-	m_tobjs.clear();
+	for (Shard &tobjShard : m_shards)
+	{
+		std::lock_guard<std::mutex> lock(tobjShard.m_mutex);
+		tobjShard.m_tobjs.clear();
+		tobjShard.m_lru.clear();
+		tobjShard.m_exported = HashIndex();
+		tobjShard.m_missing = HashIndex();
+		tobjShard.m_bytes = 0;
+		tobjShard.m_materials.clear();
+		tobjShard.m_materialLru.clear();
+	}
+}
+
+void ResourceLibrary::evict(Shard &shard)
+{
+	const u64 budget = Config::s_resourceLibrarySize / SHARD_COUNT;
+	if (Config::s_resourceLibrarySize == 0)
+	{
+		return;
+	}
+
+	for (auto it = shard.m_lru.end(); shard.m_bytes > budget && it != shard.m_lru.begin();)
+	{
+		--it;
+		const SharedPtr<Slot> &slot = it->second;
+
+		// slot is referenced only by threads inside obtain, tobj by textures of materials;
+		// neither can gain a reference while the shard is locked unless it already has one
+		if (slot.use_count() != 1 || slot->m_size == 0 || (slot->m_tobj && slot->m_tobj.use_count() != 1))
+		{
+			continue;
+		}
+
+		if (slot->m_tobj && slot->m_tobj->isExported())
+		{
+			shard.m_exported.insert(slot->m_hash, 0);
+		}
+		else if (!slot->m_tobj)
+		{
+			shard.m_missing.insert(slot->m_hash, 0);
+		}
+		shard.m_bytes -= slot->m_size;
+		shard.m_tobjs.erase(it->first);
+		it = shard.m_lru.erase(it);
+	}
+
+	// materials are referenced by models using them, they are parsed again once obtained after eviction
+	for (auto it = shard.m_materialLru.end(); shard.m_bytes > budget && it != shard.m_materialLru.begin();)
+	{
+		--it;
+		const SharedPtr<MaterialSlot> &slot = it->second;
+		if (slot.use_count() != 1 || slot->m_size == 0 || slot->m_failed || slot->m_material.use_count() != 1)
+		{
+			continue;
+		}
+
+		shard.m_bytes -= slot->m_size;
+		shard.m_materials.erase(it->first);
+		it = shard.m_materialLru.erase(it);
+	}
 }
 
 /* eof */
@@ -24,18 +24,71 @@
 
 #include <utils/explicit_singleton.h>
 #include <material/material.h>
+#include <fs/hash_index.h>
 
 class ResourceLibrary : public ExplicitSingleton<ResourceLibrary>
 {
 public:
 	using Entry = SharedPtr<TextureObject>;
+	using MaterialEntry = SharedPtr<const Material>;
 
 public:
+	/**
+	 * Returns loaded tobj, nullptr when it cannot be loaded. Safe to call from multiple threads,
+	 * every tobj is loaded once and threads asking for it meanwhile wait for the first one.
+	 *
+	 * Tobjs nobody refers to are evicted, least recently used first, once the library exceeds
+	 * Config::s_resourceLibrarySize. Paths of evicted tobjs which were already exported are remembered,
+	 * so when such tobj is obtained again it is not exported for the second time.
+	 */
 	Entry obtain(String tobjfile);
+
+	/**
+	 * Returns material parsed from given resolved path, shared by every look and model referring to it.
+	 * One which failed to load is kept as parsed, so it is never nullptr. Loaded materials nobody refers to
+	 * are evicted under the same budget as tobjs and parsed again when obtained later.
+	 */
+	MaterialEntry obtainMaterial(String matfile);
+
 	void destroy();
 
 private:
-	UnorderedMap<String, Entry> m_tobjs;
+	struct Slot
+	{
+		std::once_flag m_loaded;
+		Entry m_tobj; // nullptr when loading failed
+		u64 m_hash = 0;
+		u64 m_size = 0; // counted in bytes of the shard once loaded
+	};
+	using LruList = List<Pair<String, SharedPtr<Slot>>>;
+
+	struct MaterialSlot
+	{
+		std::once_flag m_loaded;
+		SharedPtr<Material> m_material;
+		u64 m_size = 0; // counted in bytes of the shard once loaded
+		bool m_failed = false; // kept, so the failure is reported once
+	};
+	using MaterialLruList = List<Pair<String, SharedPtr<MaterialSlot>>>;
+
+	// resources are spread over shards by hash of path, so lookups of different ones rarely wait for each other
+	struct Shard
+	{
+		std::mutex m_mutex;
+		LruList m_lru; // most recently used first
+		UnorderedMap<String, LruList::iterator> m_tobjs;
+		HashIndex m_exported; // path hashes of evicted tobjs which were exported
+		HashIndex m_missing; // path hashes of evicted tobjs which failed to load
+		MaterialLruList m_materialLru; // most recently used first
+		UnorderedMap<String, MaterialLruList::iterator> m_materials;
+		u64 m_bytes = 0; // of tobjs and materials
+	};
+	static constexpr size_t SHARD_COUNT = 16;
+
+	void evict(Shard &shard);
+
+private:
+	SizedArray<Shard, SHARD_COUNT> m_shards;
 };
 
 /* eof */
@@ -27,9 +27,9 @@
 
 #include <resource_lib.h>
 
-bool Texture::load()
+SharedPtr<TextureObject> Texture::texobj() const
 {
-	return (m_texObj = ResourceLibrary::Get()->obtain(m_texture)) != nullptr;
+	return ResourceLibrary::Get()->obtain(m_texture);
 }
 
 /* eof */
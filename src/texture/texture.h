@@ -25,9 +25,13 @@
 class Texture
 {
 public:
-	bool load();
 	String texture() const { return m_texture; }
-	const SharedPtr<TextureObject> &texobj() const { return m_texObj; }
+
+	/**
+	 * Resolves the tobj through ResourceLibrary on every call, nullptr when it cannot be loaded.
+	 * Materials record only paths of their textures, so tobjs are read once something needs them.
+	 */
+	SharedPtr<TextureObject> texobj() const;
 
 private:
 	String m_texture;
@@ -35,8 +39,6 @@ private:
 
 	Array<Material::Attribute> m_attributes;
 
-	SharedPtr<TextureObject> m_texObj;
-
 	friend Material;
 };
 
@@ -256,9 +256,33 @@ UsageInferredSettings UsageInferredSettings::get( TextureObject::Usage usage )
 
 bool TextureObject::saveToMidFormats( String exportpath )
 {
-	if (m_converted)
-		return true;
+	std::call_once( m_exportedOnce, [ & ]
+	{
+		m_converted = exportToMidFormats( exportpath );
+	} );
+	return m_converted;
+}
+
+void TextureObject::markExported()
+{
+	std::call_once( m_exportedOnce, [ this ]
+	{
+		m_converted = true;
+	} );
+}
 
+size_t TextureObject::memoryUsage() const
+{
+	size_t result = sizeof( TextureObject ) + m_filepath.capacity();
+	for( const String &texture : m_textures )
+	{
+		result += texture.capacity();
+	}
+	return result;
+}
+
+bool TextureObject::exportToMidFormats( const String &exportpath )
+{
 	auto file = getSFS()->open(exportpath + m_filepath, FileSystem::write | FileSystem::binary);
 	if (!file)
 	{
@@ -427,7 +451,6 @@ bool TextureObject::saveToMidFormats( String exportpath )
 		*file << fmt::sprintf("bias %i" SEOL, m_bias);
 	}
 
-	m_converted = true;
 	return true;
 }
 
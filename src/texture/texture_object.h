@@ -65,9 +65,14 @@ public:
 
 public:
 	bool load( String filepath );
-	bool saveToMidFormats( String exportpath );
+	bool saveToMidFormats( String exportpath ); // exports once, threads calling it meanwhile wait for the result
+
+	void markExported(); // following saveToMidFormats does nothing, the tobj was exported earlier in the run
+	bool isExported() const { return m_converted; } // not synchronized with saveToMidFormats running on other thread
+	size_t memoryUsage() const;
 
 private:
+	bool exportToMidFormats( const String &exportpath );
 	bool loadPreFirstStep( FileSystem *fs, String filepath );
 	bool loadPreSecondStep( FileSystem *fs, String filepath );
 	bool load( FileSystem *fs, String filepath );
@@ -93,6 +98,7 @@ private:
 	bool m_linearColorSpace = false;
 
 	String m_filepath; // @example /vehicle/truck/share/glass.tobj
+	std::once_flag m_exportedOnce;
 	bool m_converted = false;
 
 	Usage m_usage = Usage::none;
@@ -23,6 +23,64 @@
 #include "prerequisites.h"
 
 #include "utils/compression.h"
+#include "utils/thread_pool.h"
+#include "config.h"
+
+#include <libdeflate/libdeflate.h>
+
+namespace
+{
+	// libdeflate decompressor keeps no state between calls, but it cannot be shared between threads
+	class ThreadDecompressor
+	{
+	public:
+		ThreadDecompressor() : m_decompressor( libdeflate_alloc_decompressor() ) {}
+		~ThreadDecompressor() { libdeflate_free_decompressor( m_decompressor ); }
+
+		static libdeflate_decompressor *get()
+		{
+			static thread_local ThreadDecompressor instance;
+			return instance.m_decompressor;
+		}
+
+	private:
+		libdeflate_decompressor *m_decompressor;
+	};
+
+	class ThreadGDeflateDecompressor
+	{
+	public:
+		ThreadGDeflateDecompressor() : m_decompressor( libdeflate_alloc_gdeflate_decompressor() ) {}
+		~ThreadGDeflateDecompressor() { libdeflate_free_gdeflate_decompressor( m_decompressor ); }
+
+		static libdeflate_gdeflate_decompressor *get()
+		{
+			static thread_local ThreadGDeflateDecompressor instance;
+			return instance.m_decompressor;
+		}
+
+	private:
+		libdeflate_gdeflate_decompressor *m_decompressor;
+	};
+
+	// shared by every GDeflate stream, the thread calling unCompress_gdeflate is one of the workers too
+	ThreadPool *gdeflateThreadPool()
+	{
+		static const UniquePtr<ThreadPool> pool = []() -> UniquePtr<ThreadPool>
+		{
+			const u32 workers = Config::s_gdeflateWorkers > 0 ? Config::s_gdeflateWorkers : ThreadPool::hardwareConcurrency();
+			return workers > 1 ? std::make_unique<ThreadPool>( workers - 1 ) : nullptr;
+		}();
+		return pool.get();
+	}
+
+	u32 readU32( const uint8_t *data )
+	{
+		u32 value;
+		memcpy( &value, data, sizeof( value ) );
+		return value;
+	}
+}
 
 bool unCompress_zlib( void *output, uint64_t outputCapacity, const void *input, uint64_t inputSize )
 {
@@ -51,4 +109,146 @@ bool unCompress_zlib( void *output, uint64_t outputCapacity, const void *input,
 	return ret == Z_OK || ret == Z_STREAM_END;
 }
 
+bool unCompressWhole_zlib( void *output, uint64_t outputSize, const void *input, uint64_t inputSize )
+{
+	libdeflate_decompressor *const decompressor = ThreadDecompressor::get();
+	if( !decompressor || outputSize > SIZE_MAX || inputSize > SIZE_MAX )
+	{
+		return false;
+	}
+	return libdeflate_zlib_decompress( decompressor, input, static_cast< size_t >( inputSize ), output, static_cast< size_t >( outputSize ), nullptr ) == LIBDEFLATE_SUCCESS;
+}
+
+bool unCompressWhole_deflate( void *output, uint64_t outputSize, const void *input, uint64_t inputSize )
+{
+	libdeflate_decompressor *const decompressor = ThreadDecompressor::get();
+	if( !decompressor || outputSize > SIZE_MAX || inputSize > SIZE_MAX )
+	{
+		return false;
+	}
+	return libdeflate_deflate_decompress( decompressor, input, static_cast< size_t >( inputSize ), output, static_cast< size_t >( outputSize ), nullptr ) == LIBDEFLATE_SUCCESS;
+}
+
+/*
+ * Tile stream layout:
+ *   u8 id (4), u8 magic (id ^ 0xff), u16 tile count, u32 { tile size index : 2, last tile size : 18, reserved : 12 }
+ *   u32 tile offsets[ tile count ] - relative to the end of this table, entry 0 holds compressed size of the last tile
+ *   tiles
+ */
+uint64_t GDeflateTileStream::tablesSize( const void *header )
+{
+	static constexpr uint8_t STREAM_ID = 4;
+
+	const uint8_t *const data = static_cast< const uint8_t * >( header );
+	if( data[ 0 ] != STREAM_ID || data[ 1 ] != ( STREAM_ID ^ 0xff ) )
+	{
+		return 0;
+	}
+	const u32 tileCount = data[ 2 ] | ( data[ 3 ] << 8 );
+	return HEADER_SIZE + uint64_t( tileCount ) * sizeof( u32 );
+}
+
+bool GDeflateTileStream::parse( const void *tables, uint64_t streamSize )
+{
+	const uint8_t *const data = static_cast< const uint8_t * >( tables );
+	const uint64_t tilesBegin = tablesSize( data );
+	if( tilesBegin == 0 || tilesBegin > streamSize )
+	{
+		return false;
+	}
+
+	const u32 flags = readU32( data + 4 );
+	if( ( flags & 3 ) != 1 ) // 64 KB tiles
+	{
+		return false;
+	}
+	m_lastTileSize = ( flags >> 2 ) & 0x3ffff;
+	if( m_lastTileSize > TILE_SIZE )
+	{
+		return false;
+	}
+
+	const u32 tileCount = static_cast< u32 >( ( tilesBegin - HEADER_SIZE ) / sizeof( u32 ) );
+	m_tileOffsets.resize( tileCount + 1 );
+	for( u32 i = 0; i < tileCount; ++i )
+	{
+		m_tileOffsets[ i ] = tilesBegin + ( i > 0 ? readU32( data + HEADER_SIZE + i * sizeof( u32 ) ) : 0 );
+	}
+	m_tileOffsets[ tileCount ] = tileCount > 0 ? m_tileOffsets[ tileCount - 1 ] + readU32( data + HEADER_SIZE ) : tilesBegin;
+
+	for( u32 i = 0; i < tileCount; ++i )
+	{
+		if( m_tileOffsets[ i + 1 ] < m_tileOffsets[ i ] || m_tileOffsets[ i + 1 ] > streamSize )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+uint64_t GDeflateTileStream::uncompressedSize() const
+{
+	if( tileCount() == 0 )
+	{
+		return 0;
+	}
+	return uint64_t( tileCount() - 1 ) * TILE_SIZE + tileUncompressedSize( tileCount() - 1 );
+}
+
+u32 GDeflateTileStream::tileUncompressedSize( u32 index ) const
+{
+	return index + 1 == tileCount() && m_lastTileSize != 0 ? m_lastTileSize : TILE_SIZE;
+}
+
+bool GDeflateTileStream::decompressTile( u32 index, const void *tile, void *output ) const
+{
+	libdeflate_gdeflate_decompressor *const decompressor = ThreadGDeflateDecompressor::get();
+	if( !decompressor || index >= tileCount() )
+	{
+		return false;
+	}
+
+	libdeflate_gdeflate_in_page page;
+	page.data = tile;
+	page.nbytes = tileCompressedSize( index );
+
+	const u32 expected = tileUncompressedSize( index );
+	size_t actual = 0;
+	return libdeflate_gdeflate_decompress( decompressor, &page, 1, output, expected, &actual ) == LIBDEFLATE_SUCCESS && actual == expected;
+}
+
+bool unCompress_gdeflate( void *output, uint64_t outputSize, const void *input, uint64_t inputSize )
+{
+	GDeflateTileStream stream;
+	if( inputSize < GDeflateTileStream::HEADER_SIZE || !stream.parse( input, inputSize ) || stream.uncompressedSize() != outputSize )
+	{
+		return false;
+	}
+
+	const uint8_t *const in = static_cast< const uint8_t * >( input );
+	uint8_t *const out = static_cast< uint8_t * >( output );
+	ThreadPool *const pool = stream.tileCount() > 1 ? gdeflateThreadPool() : nullptr;
+	if( !pool )
+	{
+		for( u32 i = 0; i < stream.tileCount(); ++i )
+		{
+			if( !stream.decompressTile( i, in + stream.tileOffset( i ), out + uint64_t( i ) * GDeflateTileStream::TILE_SIZE ) )
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	std::atomic<bool> succeeded = true;
+	pool->parallelFor( stream.tileCount(), [&]( u32 index )
+	{
+		if( succeeded && !stream.decompressTile( index, in + stream.tileOffset( index ), out + uint64_t( index ) * GDeflateTileStream::TILE_SIZE ) )
+		{
+			succeeded = false;
+		}
+	} );
+	return succeeded;
+}
+
 /* eof */
@@ -24,4 +24,59 @@
 
 bool unCompress_zlib(void *output, uint64_t outputCapacity, const void *input, uint64_t inputSize);
 
+/**
+ * One-shot decompression of a whole stream with libdeflate, considerably faster than inflating it in chunks.
+ * outputSize has to be exact size of the uncompressed data.
+ */
+bool unCompressWhole_zlib(void *output, uint64_t outputSize, const void *input, uint64_t inputSize);
+bool unCompressWhole_deflate(void *output, uint64_t outputSize, const void *input, uint64_t inputSize); // raw deflate, without zlib header
+
+/**
+ * View over GDeflate tile stream (hashfs v2 compression 3). Data is split into 64 KB tiles,
+ * each of them compressed independently, so they can be decoded in any order and in parallel.
+ */
+class GDeflateTileStream
+{
+public:
+	static constexpr u32 TILE_SIZE = 64 * 1024;
+	static constexpr u32 HEADER_SIZE = 8;
+
+public:
+	/**
+	 * @brief Returns size of the stream header together with tile table, 0 when header is invalid
+	 * @param[in] header First HEADER_SIZE bytes of the stream
+	 */
+	static uint64_t tablesSize(const void *header);
+
+	/**
+	 * @brief Parses and validates tile table
+	 * @param[in] tables First tablesSize() bytes of the stream, only referenced during this call
+	 * @param[in] streamSize Size of the whole compressed stream
+	 */
+	bool parse(const void *tables, uint64_t streamSize);
+
+	u32 tileCount() const { return static_cast<u32>(m_tileOffsets.size() - 1); }
+	uint64_t uncompressedSize() const;
+	u32 tileUncompressedSize(u32 index) const;
+
+	uint64_t tileOffset(u32 index) const { return m_tileOffsets[index]; } // from the beginning of the stream
+	u32 tileCompressedSize(u32 index) const { return static_cast<u32>(m_tileOffsets[index + 1] - m_tileOffsets[index]); }
+
+	/**
+	 * @brief Decompresses single tile, output has to hold exactly tileUncompressedSize(index) bytes
+	 * @param[in] tile Compressed tile, tileCompressedSize(index) bytes located at tileOffset(index)
+	 */
+	bool decompressTile(u32 index, const void *tile, void *output) const;
+
+private:
+	Array<uint64_t> m_tileOffsets = Array<uint64_t>(1, 0); // tile count + 1 entries, the last one is end of the stream
+	u32 m_lastTileSize = 0;
+};
+
+/**
+ * Decompresses whole GDeflate tile stream. Tiles are spread across Config::s_gdeflateWorkers threads.
+ * outputSize has to be exact size of the uncompressed data.
+ */
+bool unCompress_gdeflate(void *output, uint64_t outputSize, const void *input, uint64_t inputSize);
+
 /* eof */
@@ -0,0 +1,142 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/utils/thread_pool.cpp
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+#include "prerequisites.h"
+
+#include "utils/thread_pool.h"
+
+ThreadPool::ThreadPool( u32 workers )
+{
+	workers = std::max( workers, 1u );
+	m_workers.reserve( workers );
+	for( u32 i = 0; i < workers; ++i )
+	{
+		m_workers.emplace_back( &ThreadPool::workerMain, this );
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_stopping = true;
+	}
+	m_taskAvailable.notify_all();
+	for( std::thread &worker : m_workers )
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::submit( Task task )
+{
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_tasks.push_back( std::move( task ) );
+		++m_pending;
+	}
+	m_taskAvailable.notify_one();
+}
+
+void ThreadPool::wait()
+{
+	std::unique_lock<std::mutex> lock( m_mutex );
+	m_tasksDone.wait( lock, [this] { return m_pending == 0; } );
+}
+
+void ThreadPool::parallelFor( u32 count, const std::function<void( u32 index )> &function )
+{
+	struct State
+	{
+		std::atomic<u32> m_next = 0;
+		u32 m_done = 0;
+		std::mutex m_mutex;
+		std::condition_variable m_finished;
+	};
+
+	// helpers may start after everything is done, so they must not reference the stack of this call
+	auto state = std::make_shared<State>();
+	auto process = [state, count]( const std::function<void( u32 index )> *function )
+	{
+		u32 processed = 0;
+		for( u32 index; ( index = state->m_next++ ) < count; ++processed )
+		{
+			( *function )( index );
+		}
+		if( processed > 0 )
+		{
+			std::lock_guard<std::mutex> lock( state->m_mutex );
+			state->m_done += processed;
+			if( state->m_done == count )
+			{
+				state->m_finished.notify_all();
+			}
+		}
+	};
+
+	const u32 helpers = std::min( workerCount(), count > 0 ? count - 1 : 0 );
+	auto sharedFunction = std::make_shared<std::function<void( u32 index )>>( function );
+	for( u32 i = 0; i < helpers; ++i )
+	{
+		submit( [process, sharedFunction] { process( sharedFunction.get() ); } );
+	}
+
+	process( &function );
+
+	std::unique_lock<std::mutex> lock( state->m_mutex );
+	state->m_finished.wait( lock, [&] { return state->m_done == count; } );
+}
+
+u32 ThreadPool::hardwareConcurrency()
+{
+	return std::max( std::thread::hardware_concurrency(), 1u );
+}
+
+void ThreadPool::workerMain()
+{
+	for( ;; )
+	{
+		Task task;
+		{
+			std::unique_lock<std::mutex> lock( m_mutex );
+			m_taskAvailable.wait( lock, [this] { return m_stopping || !m_tasks.empty(); } );
+			if( m_tasks.empty() )
+			{
+				return;
+			}
+			task = std::move( m_tasks.front() );
+			m_tasks.pop_front();
+		}
+
+		task();
+
+		{
+			std::lock_guard<std::mutex> lock( m_mutex );
+			if( --m_pending == 0 )
+			{
+				m_tasksDone.notify_all();
+			}
+		}
+	}
+}
+
+/* eof */
@@ -0,0 +1,78 @@
+/******************************************************************************
+ *
+ *  Project:	ConverterPIX @ Core
+ *  File:		/utils/thread_pool.h
+ *
+ *		  _____                          _            _____ _______   __
+ *		 / ____|                        | |          |  __ \_   _\ \ / /
+ *		| |     ___  _ ____   _____ _ __| |_ ___ _ __| |__) || |  \ V /
+ *		| |    / _ \| '_ \ \ / / _ \ '__| __/ _ \ '__|  ___/ | |   > <
+ *		| |___| (_) | | | \ V /  __/ |  | ||  __/ |  | |    _| |_ / . \
+ *		 \_____\___/|_| |_|\_/ \___|_|   \__\___|_|  |_|   |_____/_/ \_\
+ *
+ *
+ *  Copyright (C) 2024 Michal Wojtowicz.
+ *  All rights reserved.
+ *
+ *   This software is ditributed WITHOUT ANY WARRANTY; without even
+ *   the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *   PURPOSE. See the copyright file for more information.
+ *
+ *****************************************************************************/
+
+#pragma once
+
+class ThreadPool
+{
+public:
+	using Task = std::function<void()>;
+
+public:
+	/**
+	 * @brief Spawns given number of worker threads (at least one)
+	 */
+	explicit ThreadPool( u32 workers );
+	~ThreadPool();
+
+	ThreadPool( const ThreadPool & ) = delete;
+	ThreadPool &operator=( const ThreadPool & ) = delete;
+
+	/**
+	 * @brief Queues task for execution on one of the workers
+	 */
+	void submit( Task task );
+
+	/**
+	 * @brief Blocks until every submitted task is finished
+	 */
+	void wait();
+
+	/**
+	 * @brief Calls function for each index in [0, count) using the workers and the calling thread
+	 *
+	 * Returns once every index is processed. The caller takes part in the work, so it is safe
+	 * to call it even when all workers are busy (or from one of the workers).
+	 */
+	void parallelFor( u32 count, const std::function<void( u32 index )> &function );
+
+	u32 workerCount() const { return static_cast<u32>( m_workers.size() ); }
+
+	/**
+	 * @brief Returns number of hardware threads (at least one)
+	 */
+	static u32 hardwareConcurrency();
+
+private:
+	void workerMain();
+
+private:
+	Array<std::thread> m_workers;
+	List<Task> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_taskAvailable;
+	std::condition_variable m_tasksDone;
+	size_t m_pending = 0;
+	bool m_stopping = false;
+};
+
+/* eof */